@@ -0,0 +1,37 @@
+#include "arena.hpp"
+#include <algorithm>
+
+Arena::Arena(std::size_t block_size) : block_size(block_size) {}
+
+Arena::~Arena() {
+    reset();
+}
+
+void* Arena::allocate(std::size_t size, std::size_t alignment) {
+    while (current_block < blocks.size()) {
+        auto& block = blocks[current_block];
+        std::size_t aligned = (offset + alignment - 1) / alignment * alignment;
+        if (aligned + size <= block.size) {
+            offset = aligned + size;
+            return block.data.get() + aligned;
+        }
+        ++current_block;
+        offset = 0;
+    }
+
+    // Memory from new[] is suitably aligned for any fundamental type, so a
+    // fresh block can always start at offset zero.
+    std::size_t const size_needed = std::max(block_size, size);
+    blocks.push_back({std::unique_ptr<char[]>(new char[size_needed]), size_needed});
+    current_block = blocks.size() - 1;
+    offset = size;
+    return blocks.back().data.get();
+}
+
+void Arena::reset() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+        it->destroy(it->object);
+    destructors.clear();
+    current_block = 0;
+    offset = 0;
+}
@@ -0,0 +1,98 @@
+#ifndef CHAPTER_20_ARENA_HPP
+#define CHAPTER_20_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// A bump allocator.  Objects created in an arena are placed one after another
+// in large blocks, and are all destroyed at once by reset() or by the arena's
+// destructor.  The blocks themselves are kept around by reset(), so an arena
+// that is reused for similarly-sized work stops allocating after a while.
+//
+// Giving the memory back takes constant time, but reset() still runs the
+// destructor of every object created, so it takes time in proportion to their
+// number.  The expression nodes cannot do without: they have virtual
+// destructors, a NumberExpr may hold a big Integer on the heap, and folding
+// puts nodes from the heap among an arena node's children.  Skipping their
+// destructors would leak all of those.
+class Arena {
+    struct Block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    struct Destructor {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<Destructor> destructors;
+    std::size_t current_block = 0;
+    std::size_t offset = 0;
+    std::size_t block_size;
+
+    template <typename T>
+    static void destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+public:
+    explicit Arena(std::size_t block_size = 16 * 1024);
+    Arena(Arena const&) = delete;
+    Arena& operator=(Arena const&) = delete;
+    ~Arena();
+
+    void* allocate(std::size_t size, std::size_t alignment);
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        destructors.push_back({&destroy<T>, object});
+        return object;
+    }
+
+    void reset();
+};
+
+// Lets standard containers take their memory from an arena.  A null arena
+// means the container uses the normal heap, so the same container type can
+// be used both inside and outside of an arena.
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena* arena = nullptr) : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        if (arena)
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) {
+        if (!arena)
+            ::operator delete(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+    return lhs.arena == rhs.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+    return !(lhs == rhs);
+}
+
+#endif
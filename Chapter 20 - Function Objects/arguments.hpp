@@ -0,0 +1,26 @@
+#ifndef CHAPTER_20_ARGUMENTS_HPP
+#define CHAPTER_20_ARGUMENTS_HPP
+
+#include "integer.hpp"
+#include <cstddef>
+
+// A read-only view of the arguments to an operation.  The values themselves
+// live elsewhere, usually on an evaluation stack, so passing Arguments around
+// never allocates.
+class Arguments {
+    Integer const* first;
+    Integer const* last;
+
+public:
+    Arguments(Integer const* first, Integer const* last) : first(first), last(last) {}
+
+    Integer const* begin() const { return first; }
+    Integer const* end() const { return last; }
+
+    std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+
+    Integer const& operator[](std::size_t i) const { return first[i]; }
+};
+
+#endif
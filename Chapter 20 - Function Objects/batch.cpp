@@ -0,0 +1,103 @@
+#include "batch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Lines are read in batches.  While the workers evaluate one batch, the main
+// thread writes out the results of the previous one and reads the next one,
+// so that input and output do not hold up the evaluation.
+std::size_t const lines_per_batch = 1 << 16;
+
+// Workers take lines from the batch in blocks of this size, which keeps them
+// busy even when some lines are much more expensive than others.
+std::size_t const lines_per_block = 256;
+
+struct Batch {
+    std::vector<std::string> lines;
+    std::vector<LineResult> results;
+    std::atomic<std::size_t> next_block{0};
+};
+
+void read_batch(std::istream& in, Batch& batch) {
+    batch.lines.resize(lines_per_batch);
+    std::size_t count = 0;
+    while (count < lines_per_batch && std::getline(in, batch.lines[count]))
+        ++count;
+    batch.lines.resize(count);
+    batch.results.resize(count);
+    batch.next_block = 0;
+}
+
+void write_batch(std::ostream& out, std::ostream& err, Batch const& batch) {
+    for (auto const& result : batch.results)
+        (result.ok ? out : err) << result.text << '\n';
+}
+
+void work_on(Batch& batch, LineEvaluator& evaluator) {
+    auto const size = batch.lines.size();
+    for (;;) {
+        auto const first = batch.next_block++ * lines_per_block;
+        if (first >= size)
+            return;
+        auto const last = std::min(first + lines_per_block, size);
+        for (auto i = first; i != last; ++i)
+            batch.results[i] = evaluator.evaluate(batch.lines[i]);
+    }
+}
+
+std::vector<std::thread> start_workers(Batch& batch, std::vector<std::unique_ptr<LineEvaluator>>& evaluators) {
+    std::vector<std::thread> workers;
+    for (auto& evaluator : evaluators)
+        workers.emplace_back(work_on, std::ref(batch), std::ref(*evaluator));
+    return workers;
+}
+
+void join_all(std::vector<std::thread>& workers) {
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+EvaluatorStatistics evaluate_batch(std::istream& in, std::ostream& out, std::ostream& err,
+                                    SymbolTable const& symbol_table, EvaluationOptions const& options,
+                                    unsigned jobs) {
+    jobs = std::max(jobs, 1u);
+
+    // Every worker has a cache of its own, so that they never have to wait
+    // for each other; together they stay within the limit.
+    auto worker_options = options;
+    worker_options.cache_bytes = options.cache_bytes / jobs;
+    if (options.cache_bytes > 0 && worker_options.cache_bytes == 0)
+        worker_options.cache_bytes = 1;
+
+    std::vector<std::unique_ptr<LineEvaluator>> evaluators;
+    for (unsigned i = 0; i < jobs; ++i)
+        evaluators.emplace_back(new LineEvaluator(symbol_table, worker_options));
+
+    Batch batches[2];
+    Batch* current = &batches[0];
+    Batch* next = &batches[1];
+
+    std::vector<std::thread> workers;
+    read_batch(in, *current);
+    if (!current->lines.empty())
+        workers = start_workers(*current, evaluators);
+
+    while (!current->lines.empty()) {
+        read_batch(in, *next);
+        join_all(workers);
+        if (!next->lines.empty())
+            workers = start_workers(*next, evaluators);
+        write_batch(out, err, *current);
+        std::swap(current, next);
+    }
+
+    EvaluatorStatistics total;
+    for (auto const& evaluator : evaluators)
+        total += evaluator->get_statistics();
+    return total;
+}
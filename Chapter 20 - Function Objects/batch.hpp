@@ -0,0 +1,19 @@
+#ifndef CHAPTER_20_BATCH_HPP
+#define CHAPTER_20_BATCH_HPP
+
+#include "line_evaluator.hpp"
+#include "symbol_table.hpp"
+#include <istream>
+#include <ostream>
+
+// Evaluates every line of input, spreading the work over the given number of
+// worker threads.  Results go to out and errors to err, both in the order of
+// the input lines, exactly as if the lines had been evaluated one by one.
+//
+// The symbol table is shared between the workers and must not be modified
+// while this runs.
+EvaluatorStatistics evaluate_batch(std::istream& in, std::ostream& out, std::ostream& err,
+                                    SymbolTable const& symbol_table, EvaluationOptions const& options,
+                                    unsigned jobs);
+
+#endif
@@ -0,0 +1,81 @@
+/* Compares lookups in SymbolTable with lookups in the std::map it replaced.
+ * This is a separate program, so it is not built along with the rest of the
+ * chapter.  From this directory:
+ *
+ *     g++ -std=c++11 -O2 -o symbol_lookup symbol_lookup.cpp ../symbol_table.cpp
+ *         ../builtin_operations.cpp ../checked_arithmetic.cpp ../integer.cpp
+ *
+ * Three workloads are timed: looking up only builtins, looking up names a
+ * user has defined, and looking up names that are not there at all.
+ */
+
+#include "../symbol_table.hpp"
+#include "../builtin_operations.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using OperationMap = std::map<std::string, Operation>;
+
+Integer user_operation(Arguments) {
+    return 0;
+}
+
+// Looks every name up repeatedly, returning the nanoseconds per lookup.  The
+// number of hits is written to found, so that the lookups cannot be optimized
+// away.
+template <typename Find>
+double time_lookups(std::vector<std::string> const& names, Find find, std::size_t& found) {
+    std::size_t const rounds = 2000000 / names.size() + 1;
+    found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t r = 0; r < rounds; ++r)
+        for (auto const& name : names)
+            found += find(name) != nullptr;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (rounds * names.size());
+}
+
+void compare(std::string const& label, std::vector<std::string> const& names,
+             SymbolTable const& table, OperationMap const& map) {
+    std::size_t table_found, map_found;
+    double table_ns = time_lookups(names, [&](std::string const& name) { return table.find_symbol(name); },
+                                   table_found);
+    double map_ns = time_lookups(names, [&](std::string const& name) -> Operation const* {
+        auto it = map.find(name);
+        return it == map.end() ? nullptr : &it->second;
+    }, map_found);
+
+    if (table_found != map_found)
+        std::cerr << label << ": the table and the map disagree!\n";
+    std::cout << std::left << std::setw(10) << label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << table_ns << " ns" << std::setw(10) << map_ns << " ns" << std::setw(9)
+              << map_ns / table_ns << "x\n";
+}
+
+int main() {
+    SymbolTable table = get_default_symbol_table();
+    OperationMap map{{"+", builtin_add}, {"-", builtin_subtract}, {"*", builtin_multiply}, {"/", builtin_divide}};
+
+    std::vector<std::string> builtins{"+", "-", "*", "/"};
+    std::vector<std::string> defined, missing;
+    for (int i = 0; i < 64; ++i) {
+        defined.push_back("function" + std::to_string(i));
+        missing.push_back("unknown" + std::to_string(i));
+        table.define(defined.back(), user_operation);
+        map[defined.back()] = user_operation;
+    }
+
+    std::cout << "workload       table       map  speedup\n";
+    compare("builtins", builtins, table, map);
+    compare("defined", defined, table, map);
+    compare("missing", missing, table, map);
+
+    // Without user definitions the flat table is empty and skipped entirely.
+    SymbolTable defaults = get_default_symbol_table();
+    OperationMap default_map{{"+", builtin_add}, {"-", builtin_subtract}, {"*", builtin_multiply}, {"/", builtin_divide}};
+    compare("defaults", builtins, defaults, default_map);
+}
@@ -0,0 +1,286 @@
+/* Measures how fast the pieces of the interpreter are: tokens lexed per
+ * second, nodes parsed per second and expressions evaluated per second, on a
+ * few kinds of input.  This is a separate program, so it is not built along
+ * with the rest of the chapter.  From this directory:
+ *
+ *     g++ -std=c++11 -O2 -pthread -o throughput throughput.cpp
+ *         $(ls ../[a-z]*.cpp | grep -v main.cpp)
+ *
+ * Every benchmark is run a number of times (--repetitions N, 10 by default)
+ * and the report gives the median rate along with the minimum, maximum and
+ * standard deviation of the rate over the repetitions.  Passing --json
+ * prints the results as JSON instead, for comparing builds with a script;
+ * --filter TEXT only runs the benchmarks whose name contains TEXT.
+ *
+ * lex/bulk times tokenize_all over the whole input, and parse/tokens times
+ * parsing from tokens lexed beforehand, so that the two add up to a parse
+ * that lexes as it goes.  lex/parallel2 and lex/parallel4 do the same as
+ * lex/bulk with tokenize_parallel on two and four threads.  edit times
+ * changing one character in the middle of the input with an
+ * IncrementalParser, which parses only what the edit touched.
+ *
+ * The inputs are:
+ *
+ *     shallow    many small expressions, like (+ 1 (* 2 3)), one per line
+ *     deep       one expression nested 10000 levels deep
+ *     wide       one call with 100000 arguments
+ *     lines      a mix of the above kinds of expression, one per line
+ */
+
+#include "../buffer_lexer.hpp"
+#include "../flat_expression.hpp"
+#include "../lexer.hpp"
+#include "../parallel_lexer.hpp"
+#include "../parser.hpp"
+#include "../symbol_table.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Input {
+    std::string name;
+    // One expression per line.
+    std::vector<std::string> lines;
+};
+
+std::string shallow_line(int i) {
+    return "(+ " + std::to_string(i % 97) + " (* " + std::to_string(i % 13) + " 3) (- 100 " + std::to_string(i % 7) + "))";
+}
+
+std::string deep_line(int depth) {
+    std::string line;
+    for (int i = 0; i < depth; ++i)
+        line += i % 2 ? "(* 1 " : "(+ 1 ";
+    line += '1';
+    line.append(depth, ')');
+    return line;
+}
+
+std::string wide_line(int width) {
+    std::string line = "(+";
+    for (int i = 0; i < width; ++i)
+        line += ' ' + std::to_string(i % 1000);
+    return line + ')';
+}
+
+std::vector<Input> make_inputs() {
+    std::vector<Input> inputs(4);
+    inputs[0].name = "shallow";
+    for (int i = 0; i < 20000; ++i)
+        inputs[0].lines.push_back(shallow_line(i));
+    inputs[1].name = "deep";
+    inputs[1].lines.push_back(deep_line(10000));
+    inputs[2].name = "wide";
+    inputs[2].lines.push_back(wide_line(100000));
+    inputs[3].name = "lines";
+    for (int i = 0; i < 20000; ++i)
+        inputs[3].lines.push_back(i % 50 == 0 ? deep_line(50) : i % 10 == 0 ? wide_line(100) : shallow_line(i));
+    return inputs;
+}
+
+std::string join(std::vector<std::string> const& lines) {
+    std::string text;
+    for (auto const& line : lines)
+        text += line + '\n';
+    return text;
+}
+
+// A benchmark does one round of work and says how many units it handled.
+struct Benchmark {
+    std::string name;
+    std::string unit;
+    std::function<std::size_t()> run;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    std::size_t units;
+    // Units per second.
+    double median, minimum, maximum, deviation;
+};
+
+Result measure(Benchmark const& benchmark, int repetitions) {
+    // A first, untimed round warms up the caches and the allocator.
+    std::size_t const units = benchmark.run();
+
+    std::vector<double> rates;
+    for (int i = 0; i < repetitions; ++i) {
+        auto const start = std::chrono::steady_clock::now();
+        benchmark.run();
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        rates.push_back(units / elapsed.count());
+    }
+
+    std::sort(rates.begin(), rates.end());
+    double mean = 0;
+    for (auto rate : rates)
+        mean += rate / rates.size();
+    double variance = 0;
+    for (auto rate : rates)
+        variance += (rate - mean) * (rate - mean) / rates.size();
+
+    std::size_t const n = rates.size();
+    double const median = n % 2 ? rates[n / 2] : (rates[n / 2 - 1] + rates[n / 2]) / 2;
+    return {benchmark.name, benchmark.unit, units, median, rates.front(), rates.back(), std::sqrt(variance)};
+}
+
+std::vector<Benchmark> make_benchmarks(std::vector<Input> const& inputs, SymbolTable const& symbol_table) {
+    std::vector<Benchmark> benchmarks;
+    for (auto const& input : inputs) {
+        auto const text = std::make_shared<std::string>(join(input.lines));
+
+        benchmarks.push_back({"lex/stream/" + input.name, "tokens", [text] {
+            std::istringstream in(*text);
+            Lexer lexer(in);
+            std::size_t tokens = 0;
+            while (lexer.extract().type != TokenType::end_of_file)
+                ++tokens;
+            return tokens;
+        }});
+
+        benchmarks.push_back({"lex/buffer/" + input.name, "tokens", [text] {
+            BufferLexer lexer{StringRef(*text)};
+            std::size_t tokens = 0;
+            while (lexer.extract().type != TokenType::end_of_file)
+                ++tokens;
+            return tokens;
+        }});
+
+        auto const tokens = std::make_shared<TokenArray>();
+        benchmarks.push_back({"lex/bulk/" + input.name, "tokens", [text, tokens] {
+            tokenize_all(StringRef(*text), *tokens);
+            return tokens->size() - 1;
+        }});
+
+        for (unsigned jobs : {2u, 4u}) {
+            benchmarks.push_back({"lex/parallel" + std::to_string(jobs) + "/" + input.name, "tokens",
+                                  [text, tokens, jobs] {
+                tokenize_parallel(StringRef(*text), *tokens, jobs);
+                return tokens->size() - 1;
+            }});
+        }
+
+        // The number of nodes in each line is the size of its flattened form.
+        auto parsed = std::make_shared<std::vector<std::shared_ptr<Expression>>>();
+        std::size_t nodes = 0;
+        for (auto const& line : input.lines) {
+            parsed->push_back(parse_expression(StringRef(line)));
+            nodes += FlatExpression(*parsed->back()).size();
+        }
+
+        auto const lines = std::make_shared<std::vector<std::string>>(input.lines);
+        benchmarks.push_back({"parse/" + input.name, "nodes", [lines, nodes] {
+            for (auto const& line : *lines)
+                parse_expression(StringRef(line));
+            return nodes;
+        }});
+
+        benchmarks.push_back({"parse/arena/" + input.name, "nodes", [lines, nodes] {
+            Arena arena;
+            for (auto const& line : *lines) {
+                arena.reset();
+                parse_expression(StringRef(line), arena);
+            }
+            return nodes;
+        }});
+
+        // Parsing from tokens that were lexed beforehand, one line at a time.
+        auto const lexed = std::make_shared<std::vector<TokenArray>>(lines->size());
+        for (std::size_t i = 0; i < lines->size(); ++i)
+            tokenize_all(StringRef((*lines)[i]), (*lexed)[i]);
+        benchmarks.push_back({"parse/tokens/" + input.name, "nodes", [lines, lexed, nodes] {
+            for (std::size_t i = 0; i < lines->size(); ++i)
+                parse_expression((*lexed)[i], StringRef((*lines)[i]));
+            return nodes;
+        }});
+
+        // Changing one digit in the middle of the input back and forth, so
+        // that every edit leaves the text as long as it was.
+        auto const edited = std::make_shared<IncrementalParser>(StringRef(*text));
+        std::size_t digit = text->size() / 2;
+        while (!std::isdigit(static_cast<unsigned char>((*text)[digit])))
+            ++digit;
+        benchmarks.push_back({"edit/" + input.name, "edits", [edited, digit] {
+            std::size_t const edits = 100;
+            for (std::size_t i = 0; i < edits; ++i)
+                edited->edit(digit, 1, StringRef(i % 2 ? "7" : "8", 1));
+            return edits;
+        }});
+
+        for (auto const& expr : *parsed)
+            expr->bind(symbol_table);
+        benchmarks.push_back({"evaluate/" + input.name, "evaluations", [parsed, &symbol_table] {
+            Integer sum;
+            for (auto const& expr : *parsed)
+                sum = sum + expr->evaluate(symbol_table);
+            return parsed->size();
+        }});
+    }
+    return benchmarks;
+}
+
+void write_text(std::ostream& os, std::vector<Result> const& results) {
+    os << std::left << std::setw(24) << "benchmark" << std::right << std::setw(14) << "median/s"
+       << std::setw(14) << "min/s" << std::setw(14) << "max/s" << std::setw(10) << "stddev" << "  unit\n";
+    for (auto const& result : results)
+        os << std::left << std::setw(24) << result.name << std::right << std::fixed << std::setprecision(0)
+           << std::setw(14) << result.median << std::setw(14) << result.minimum << std::setw(14) << result.maximum
+           << std::setprecision(1) << std::setw(9) << 100 * result.deviation / result.median << "%  "
+           << result.unit << '\n';
+}
+
+void write_json(std::ostream& os, std::vector<Result> const& results, int repetitions) {
+    os << "{\n  \"repetitions\": " << repetitions << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto const& result = results[i];
+        os << (i == 0 ? "\n" : ",\n") << std::fixed << std::setprecision(1)
+           << "    {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit
+           << "\", \"units_per_round\": " << result.units << ", \"median\": " << result.median
+           << ", \"min\": " << result.minimum << ", \"max\": " << result.maximum
+           << ", \"stddev\": " << result.deviation << '}';
+    }
+    os << "\n  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) try {
+    int repetitions = 10;
+    bool json = false;
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        if (arg == "--repetitions" && i + 1 < argc)
+            repetitions = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--json")
+            json = true;
+        else if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else
+            throw std::runtime_error{"unknown option: " + arg};
+    }
+
+    auto const symbol_table = get_default_symbol_table();
+    std::vector<Result> results;
+    for (auto const& benchmark : make_benchmarks(make_inputs(), symbol_table))
+        if (benchmark.name.find(filter) != std::string::npos)
+            results.push_back(measure(benchmark, repetitions));
+
+    if (json)
+        write_json(std::cout, results, repetitions);
+    else
+        write_text(std::cout, results);
+}
+catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return -1;
+}
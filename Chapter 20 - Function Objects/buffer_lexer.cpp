@@ -0,0 +1,116 @@
+#include "buffer_lexer.hpp"
+#include "char_class.hpp"
+#include <stdexcept>
+
+BufferLexer::BufferLexer(char const* first, char const* last)
+    : first(first), current(first), last(last), lines(first, last) {}
+
+BufferLexer::BufferLexer(StringRef source) : BufferLexer(source.begin(), source.end()) {}
+
+Token BufferLexer::extract() {
+    current = skip_spaces(current, last);
+    Token token;
+    if (!lex_token(token))
+        throw std::runtime_error{"unrecognised character"};
+    return token;
+}
+
+void BufferLexer::extract_all(TokenArray& tokens) {
+    for (;;) {
+        current = skip_spaces(current, last);
+        char const* start = current;
+        Token token;
+        if (!lex_token(token)) {
+            tokens.unrecognised = true;
+            token = {TokenType::end_of_file, 0};
+        }
+        tokens.push_back(token, start - first, current - start);
+        if (token.type == TokenType::end_of_file)
+            return;
+    }
+}
+
+bool BufferLexer::lex_token(Token& token) {
+    if (current == last) {
+        token = {TokenType::end_of_file, 0};
+        return true;
+    }
+
+    char const c = *current;
+    if (has_class(c, char_letter)) {
+        token = lex_name();
+    } else if (has_class(c, char_digit)) {
+        token = lex_number();
+    } else if (has_class(c, char_operator)) {
+        token = lex_operator();
+    } else {
+        ++current;
+        if (c == '(')
+            token = {TokenType::open_paren, 0};
+        else if (c == ')')
+            token = {TokenType::close_paren, 0};
+        else
+            return false;
+    }
+    return true;
+}
+
+// The big_number ends where lexing stopped.
+StringRef BufferLexer::get_digits(Token token) const {
+    return StringRef(first + token.value, current);
+}
+
+Lexer::Position BufferLexer::get_position() const {
+    return lines.position(current - first);
+}
+
+std::size_t BufferLexer::get_offset() const {
+    return current - first;
+}
+
+BufferLexer::operator bool() const {
+    return true;
+}
+
+void BufferLexer::skip_line() {
+    while (current != last && *current++ != '\n') {
+    }
+}
+
+Token BufferLexer::lex_name() {
+    char const* start = current;
+    current = skip_letters(current, last);
+    return {TokenType::name, intern(StringRef(start, current))};
+}
+
+Token BufferLexer::lex_number() {
+    char const* start = current;
+    current = skip_digits(current, last);
+    // Up to 18 digits always fit in 64 bits; only longer numbers need to be
+    // checked for overflow.
+    std::int64_t number = 0;
+    bool small = true;
+    if (current - start <= 18) {
+        for (char const* digit = start; digit != current; ++digit)
+            number = number * 10 + (*digit - '0');
+    } else {
+        for (char const* digit = start; small && digit != current; ++digit)
+            small = append_digit(number, *digit);
+    }
+    if (!small)
+        return {TokenType::big_number, start - first};
+    return {TokenType::number, number};
+}
+
+Token BufferLexer::lex_operator() {
+    char const* start = current;
+    while (current != last && has_class(*current, char_operator))
+        ++current;
+    return {TokenType::name, intern(StringRef(start, current))};
+}
+
+void tokenize_all(StringRef source, TokenArray& tokens) {
+    tokens.clear();
+    BufferLexer lexer(source);
+    lexer.extract_all(tokens);
+}
@@ -0,0 +1,55 @@
+#ifndef CHAPTER_20_BUFFER_LEXER_HPP
+#define CHAPTER_20_BUFFER_LEXER_HPP
+
+#include "lexer.hpp"
+#include "line_index.hpp"
+#include "string_ref.hpp"
+#include "token.hpp"
+#include <cstddef>
+
+// Splits a buffer that is already in memory into the same tokens, with the
+// same positions, as Lexer does for a stream.  Names are interned straight
+// from the buffer, so lexing never copies the input.  Only the offset into the
+// buffer is kept up to date; the line and column are worked out from it when
+// they are asked for.
+struct BufferLexer {
+    BufferLexer(char const* first, char const* last);
+    explicit BufferLexer(StringRef source);
+    BufferLexer(BufferLexer const&) = delete;
+
+    Token extract();
+    // Lexes everything that is left in one tight loop, rather than a token
+    // at a time as the parser asks for them, and adds it to tokens.
+    void extract_all(TokenArray& tokens);
+    // The digits of token, which must be the big_number just extracted.
+    StringRef get_digits(Token token) const;
+
+    Lexer::Position get_position() const;
+    std::size_t get_offset() const;
+
+    // A buffer, unlike a stream, cannot go bad.
+    explicit operator bool() const;
+
+    // Discards the rest of the current line, including its newline.
+    void skip_line();
+
+private:
+    char const* first;
+    char const* current;
+    char const* last;
+
+    mutable LineIndex lines;
+
+    // Lexes the token that starts at the current character.  Returns false,
+    // having skipped it, at a character that cannot start a token.
+    bool lex_token(Token& token);
+
+    Token lex_name();
+    Token lex_number();
+    Token lex_operator();
+};
+
+// Replaces the contents of tokens with all the tokens in source.
+void tokenize_all(StringRef source, TokenArray& tokens);
+
+#endif
@@ -1,7 +1,6 @@
 #include "builtin_operations.hpp"
-#include <algorithm>
-#include <functional>
-#include <numeric>
+#include "checked_arithmetic.hpp"
+#include <cstdint>
 #include <stdexcept>
 
 /* We can implement the built-in functions in "normal" C++; we don't have to
@@ -9,11 +8,21 @@
  *
  */
 
-int builtin_add(std::vector<int> const& args) {
-    return std::accumulate(std::begin(args), std::end(args), 0);
+// Integer arithmetic never overflows, so the only errors left are wrong
+// argument counts and division by zero.  Sums and products try the 64-bit
+// fast path over the whole range first.
+
+Integer builtin_add(Arguments args) {
+    std::int64_t result;
+    if (small_sum(args.begin(), args.end(), result))
+        return result;
+    Integer sum = 0;
+    for (auto const& arg : args)
+        sum = sum + arg;
+    return sum;
 }
 
-int builtin_subtract(std::vector<int> const& args) {
+Integer builtin_subtract(Arguments args) {
     if (args.size() == 1)
         return -args[0];
     if (args.size() == 2)
@@ -21,15 +30,20 @@ int builtin_subtract(std::vector<int> const& args) {
     throw std::runtime_error{"incorrect number of args to builtin_subtract"};
 }
 
-int builtin_multiply(std::vector<int> const& args) {
-    return std::accumulate(std::begin(args), std::end(args), 1, std::multiplies<int>{});
+Integer builtin_multiply(Arguments args) {
+    std::int64_t result;
+    if (small_product(args.begin(), args.end(), result))
+        return result;
+    Integer product = 1;
+    for (auto const& arg : args)
+        product = product * arg;
+    return product;
 }
 
-int builtin_divide(std::vector<int> const& args) {
+Integer builtin_divide(Arguments args) {
     if (args.size() != 2)
         throw std::runtime_error{"incorrect number of args to builtin_divide"};
-    if (args[1] == 0)
+    if (args[1].sign() == 0)
         throw std::runtime_error{"division by zero"};
     return args[0] / args[1];
 }
-
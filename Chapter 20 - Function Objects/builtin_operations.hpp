@@ -1,11 +1,40 @@
 #ifndef CHAPTER_20_BUILTIN_OPERATIONS_HPP
 #define CHAPTER_20_BUILTIN_OPERATIONS_HPP
 
-#include <vector>
+#include "arguments.hpp"
+#include <stdexcept>
 
-int builtin_add(std::vector<int> const& args);
-int builtin_subtract(std::vector<int> const& args);
-int builtin_multiply(std::vector<int> const& args);
-int builtin_divide(std::vector<int> const& args);
+Integer builtin_add(Arguments args);
+Integer builtin_subtract(Arguments args);
+Integer builtin_multiply(Arguments args);
+Integer builtin_divide(Arguments args);
+
+// The builtins above, as far as the evaluators are concerned.  A call that is
+// known to be to one of them can skip the Operation it is stored in and use
+// call_builtin instead, which the compiler can see through.
+enum class BuiltinKind {
+    none,
+    add,
+    subtract,
+    multiply,
+    divide
+};
+
+// Two arguments is by far the most common case, and needs no loop.
+inline Integer call_builtin(BuiltinKind kind, Arguments args) {
+    switch (kind) {
+    case BuiltinKind::add:
+        return args.size() == 2 ? args[0] + args[1] : builtin_add(args);
+    case BuiltinKind::subtract:
+        return args.size() == 2 ? args[0] - args[1] : builtin_subtract(args);
+    case BuiltinKind::multiply:
+        return args.size() == 2 ? args[0] * args[1] : builtin_multiply(args);
+    case BuiltinKind::divide:
+        return builtin_divide(args);
+    case BuiltinKind::none:
+        break;
+    }
+    throw std::logic_error{"call_builtin called without a builtin"};
+}
 
 #endif
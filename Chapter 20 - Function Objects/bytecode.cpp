@@ -0,0 +1,97 @@
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+void Program::emit_number(Integer value) {
+    int index = constants.size();
+    constants.push_back(std::move(value));
+    push({OpCode::push_number, index, 0}, 0);
+}
+
+void Program::emit_variable(int depth, int slot) {
+    int position = scopes[scopes.size() - 1 - depth] + slot;
+    push({OpCode::load_variable, position, 0}, 0);
+}
+
+void Program::emit_call(SymbolId name, int arg_count) {
+    auto it = std::find(std::begin(function_names), std::end(function_names), name);
+    int index = it - std::begin(function_names);
+    if (it == std::end(function_names))
+        function_names.push_back(name);
+    push({OpCode::call, index, arg_count}, arg_count);
+}
+
+void Program::emit_fail(std::string const& message) {
+    int index = error_messages.size();
+    error_messages.push_back(message);
+    push({OpCode::fail, index, 0}, 0);
+}
+
+void Program::open_scope(std::size_t variable_count) {
+    scopes.push_back(stack_depth - variable_count);
+}
+
+void Program::close_scope() {
+    int variable_count = stack_depth - 1 - scopes.back();
+    scopes.pop_back();
+    push({OpCode::leave_scope, variable_count, 0}, variable_count + 1);
+}
+
+void Program::push(Instruction instruction, std::size_t popped) {
+    code.push_back(instruction);
+    stack_depth = stack_depth - popped + 1;
+    max_stack_depth = std::max(max_stack_depth, stack_depth);
+}
+
+Program compile(Expression const& expr, SymbolTable const& symbol_table) {
+    Program program;
+    expr.compile(program);
+
+    program.generation = symbol_table.get_generation();
+    std::vector<BuiltinKind> builtins;
+    for (auto name : program.function_names) {
+        auto symbol = symbol_table.find_symbol(symbol_name(name));
+        program.functions.push_back(symbol ? &symbol->operation : nullptr);
+        builtins.push_back(symbol ? symbol->builtin : BuiltinKind::none);
+    }
+
+    for (auto& instruction : program.code) {
+        if (instruction.code != OpCode::call)
+            continue;
+        switch (builtins[instruction.operand]) {
+        case BuiltinKind::add:
+            instruction.code = OpCode::call_add;
+            break;
+        case BuiltinKind::subtract:
+            instruction.code = OpCode::call_subtract;
+            break;
+        case BuiltinKind::multiply:
+            instruction.code = OpCode::call_multiply;
+            break;
+        case BuiltinKind::divide:
+            instruction.code = OpCode::call_divide;
+            break;
+        case BuiltinKind::none:
+            break;
+        }
+    }
+
+    return program;
+}
+
+BuiltinKind builtin_called_by(OpCode code) {
+    switch (code) {
+    case OpCode::call_add:
+        return BuiltinKind::add;
+    case OpCode::call_subtract:
+        return BuiltinKind::subtract;
+    case OpCode::call_multiply:
+        return BuiltinKind::multiply;
+    case OpCode::call_divide:
+        return BuiltinKind::divide;
+    default:
+        return BuiltinKind::none;
+    }
+}
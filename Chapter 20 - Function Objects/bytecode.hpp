@@ -0,0 +1,80 @@
+#ifndef CHAPTER_20_BYTECODE_HPP
+#define CHAPTER_20_BYTECODE_HPP
+
+#include "integer.hpp"
+#include "interner.hpp"
+#include "symbol_table.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct Expression;
+
+enum class OpCode {
+    push_number,
+    load_variable,
+    leave_scope,
+    call,
+    call_add,
+    call_subtract,
+    call_multiply,
+    call_divide,
+    fail
+};
+
+// For push_number the operand is an index into Program::constants; for
+// load_variable it is the position on the stack where the variable is; for
+// leave_scope it is the number of variables to remove from under the value
+// on top; for call it is an index into Program::function_names and arg_count
+// says how many stack values the call consumes; for fail it is an index into
+// Program::error_messages.
+//
+// compile turns calls to builtins into the specialized call_* instructions,
+// which have the same operands but are run without going through the
+// Operation.
+struct Instruction {
+    OpCode code;
+    int operand;
+    int arg_count;
+};
+
+// A compiled expression.  The instructions leave exactly one value on the
+// stack.  Functions are resolved against the symbol table passed to compile;
+// when the program is run against a table with a different generation, or a
+// name was not found, it is looked up again by name.  That way errors are
+// reported at the same point as by Expression::evaluate.
+struct Program {
+    std::vector<Instruction> code;
+    std::vector<Integer> constants;
+    std::vector<SymbolId> function_names;
+    std::vector<Operation const*> functions;
+    std::vector<std::string> error_messages;
+    unsigned long long generation = 0;
+    std::size_t max_stack_depth = 0;
+
+    void emit_number(Integer value);
+    void emit_variable(int depth, int slot);
+    void emit_call(SymbolId name, int arg_count);
+    void emit_fail(std::string const& message);
+
+    // The values of the variables of a let are simply left on the stack.
+    // Once they have been emitted, open_scope makes them the innermost scope;
+    // once the body has been emitted, close_scope removes them again.
+    void open_scope(std::size_t variable_count);
+    void close_scope();
+
+private:
+    std::size_t stack_depth = 0;
+    // Where the variables of each scope start on the stack, innermost at the
+    // back.
+    std::vector<std::size_t> scopes;
+
+    void push(Instruction instruction, std::size_t popped);
+};
+
+Program compile(Expression const& expr, SymbolTable const& symbol_table);
+
+// The builtin run by one of the call_* instructions, or BuiltinKind::none.
+BuiltinKind builtin_called_by(OpCode code);
+
+#endif
@@ -0,0 +1,97 @@
+#include "char_class.hpp"
+
+constexpr unsigned char classify(int c) {
+    return c == ' ' || (c >= '\t' && c <= '\r') ? char_space
+         : (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ? char_letter
+         : c >= '0' && c <= '9' ? char_digit
+         : c == '+' || c == '*' || c == '-' || c == '/' || c == '!' || c == '=' || c == '<' || c == '>' ? char_operator
+         : 0;
+}
+
+#define CHAR_CLASS_ROW(n) \
+    classify(n), classify(n + 1), classify(n + 2), classify(n + 3), \
+    classify(n + 4), classify(n + 5), classify(n + 6), classify(n + 7), \
+    classify(n + 8), classify(n + 9), classify(n + 10), classify(n + 11), \
+    classify(n + 12), classify(n + 13), classify(n + 14), classify(n + 15)
+
+unsigned char const char_classes[256] = {
+    CHAR_CLASS_ROW(0x00), CHAR_CLASS_ROW(0x10), CHAR_CLASS_ROW(0x20), CHAR_CLASS_ROW(0x30),
+    CHAR_CLASS_ROW(0x40), CHAR_CLASS_ROW(0x50), CHAR_CLASS_ROW(0x60), CHAR_CLASS_ROW(0x70),
+    CHAR_CLASS_ROW(0x80), CHAR_CLASS_ROW(0x90), CHAR_CLASS_ROW(0xa0), CHAR_CLASS_ROW(0xb0),
+    CHAR_CLASS_ROW(0xc0), CHAR_CLASS_ROW(0xd0), CHAR_CLASS_ROW(0xe0), CHAR_CLASS_ROW(0xf0),
+};
+
+#undef CHAR_CLASS_ROW
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+// SSE2 only compares signed bytes, so each range check subtracts the start of
+// the range and 128, which moves the range down to start at -128, and then
+// checks that the result is less than -128 plus the size of the range.  Bytes
+// outside the range wrap around to somewhere above it.
+inline __m128i in_range(__m128i bytes, char low, int size) {
+    __m128i const shifted = _mm_sub_epi8(bytes, _mm_set1_epi8(static_cast<char>(low + 128)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + size)));
+}
+
+struct MatchSpaces {
+    __m128i operator()(__m128i bytes) const {
+        return _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), in_range(bytes, '\t', 5));
+    }
+};
+
+// Setting bit 5 maps every upper case letter to its lower case one, and
+// nothing else to a lower case letter.
+struct MatchLetters {
+    __m128i operator()(__m128i bytes) const {
+        return in_range(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 26);
+    }
+};
+
+struct MatchDigits {
+    __m128i operator()(__m128i bytes) const {
+        return in_range(bytes, '0', 10);
+    }
+};
+
+template <typename Match>
+char const* skip(char const* first, char const* last, CharClass cls) {
+    for (; last - first >= 16; first += 16) {
+        __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+        unsigned const others = ~_mm_movemask_epi8(Match{}(bytes)) & 0xffff;
+        if (others != 0)
+            return first + __builtin_ctz(others);
+    }
+    while (first != last && has_class(*first, cls))
+        ++first;
+    return first;
+}
+
+#else
+
+struct MatchSpaces {};
+struct MatchLetters {};
+struct MatchDigits {};
+
+template <typename Match>
+char const* skip(char const* first, char const* last, CharClass cls) {
+    while (first != last && has_class(*first, cls))
+        ++first;
+    return first;
+}
+
+#endif
+
+char const* skip_spaces(char const* first, char const* last) {
+    return skip<MatchSpaces>(first, last, char_space);
+}
+
+char const* skip_letters(char const* first, char const* last) {
+    return skip<MatchLetters>(first, last, char_letter);
+}
+
+char const* skip_digits(char const* first, char const* last) {
+    return skip<MatchDigits>(first, last, char_digit);
+}
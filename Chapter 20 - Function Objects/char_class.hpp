@@ -0,0 +1,29 @@
+#ifndef CHAPTER_20_CHAR_CLASS_HPP
+#define CHAPTER_20_CHAR_CLASS_HPP
+
+// The kinds of character the lexers tell apart.  They are looked up in a
+// table of 256 entries rather than with std::isspace and friends, which
+// consult the locale for every character.  The classes are those of the "C"
+// locale, which is the only one the program ever uses: characters outside
+// ASCII belong to none of them.
+enum CharClass : unsigned char {
+    char_space = 1,
+    char_letter = 2,
+    char_digit = 4,
+    char_operator = 8,
+};
+
+extern unsigned char const char_classes[256];
+
+inline bool has_class(char c, CharClass cls) {
+    return (char_classes[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+// Return the first character in [first, last) that is not of the class, or
+// last.  On x86 processors they look at 16 characters at a time with SSE2
+// instructions; elsewhere they go through the table one by one.
+char const* skip_spaces(char const* first, char const* last);
+char const* skip_letters(char const* first, char const* last);
+char const* skip_digits(char const* first, char const* last);
+
+#endif
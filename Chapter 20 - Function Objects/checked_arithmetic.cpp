@@ -0,0 +1,121 @@
+#include "checked_arithmetic.hpp"
+#include <type_traits>
+
+bool scalar_small_sum(Integer const* first, Integer const* last, std::int64_t& result) {
+    std::int64_t sum = 0;
+    for (; first != last; ++first)
+        if (!first->is_small() || !checked_add(sum, first->get_small(), sum))
+            return false;
+    result = sum;
+    return true;
+}
+
+// There is no 64-bit multiply with overflow detection before AVX-512, so
+// products are always done one element at a time.
+bool small_product(Integer const* first, Integer const* last, std::int64_t& result) {
+    std::int64_t product = 1;
+    for (; first != last; ++first)
+        if (!first->is_small() || !checked_multiply(product, first->get_small(), product))
+            return false;
+    result = product;
+    return true;
+}
+
+// Only on x86-64: on 32-bit x86 a pointer is four bytes, so Integer does not
+// have the layout the kernels below rely on.  Other targets use the scalar
+// loop.
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+
+#include <immintrin.h>
+
+// The vector versions read Integers as pairs of 64-bit words: the inline
+// value and the BigInt pointer.  The values are summed lane by lane, while the
+// pointers are or-ed together; a non-zero result means some value was not
+// small.
+static_assert(std::is_standard_layout<Integer>::value && sizeof(Integer) == 2 * sizeof(std::int64_t),
+              "the vectorized kernels rely on the layout of Integer");
+
+// Adding a and b overflowed exactly when the sign of the result differs from
+// the signs of both a and b, so the sign bits of (a ^ sum) & (b ^ sum) record
+// whether that ever happened in a lane.
+__attribute__((target("sse2")))
+bool sse_small_sum(Integer const* first, Integer const* last, std::int64_t& result) {
+    __m128i acc = _mm_setzero_si128();
+    __m128i bigs = _mm_setzero_si128();
+    __m128i overflow = _mm_setzero_si128();
+    for (; last - first >= 2; first += 2) {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first + 1));
+        __m128i values = _mm_unpacklo_epi64(v0, v1);
+        __m128i sum = _mm_add_epi64(acc, values);
+        overflow = _mm_or_si128(overflow, _mm_and_si128(_mm_xor_si128(acc, sum), _mm_xor_si128(values, sum)));
+        bigs = _mm_or_si128(bigs, _mm_unpackhi_epi64(v0, v1));
+        acc = sum;
+    }
+    if (_mm_movemask_pd(_mm_castsi128_pd(overflow)) != 0
+        || _mm_movemask_epi8(_mm_cmpeq_epi32(bigs, _mm_setzero_si128())) != 0xffff)
+        return false;
+
+    std::int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    std::int64_t rest;
+    if (!scalar_small_sum(first, last, rest) || !checked_add(lanes[0], lanes[1], result))
+        return false;
+    return checked_add(result, rest, result);
+}
+
+__attribute__((target("avx2")))
+bool avx2_small_sum(Integer const* first, Integer const* last, std::int64_t& result) {
+    __m256i acc = _mm256_setzero_si256();
+    __m256i bigs = _mm256_setzero_si256();
+    __m256i overflow = _mm256_setzero_si256();
+    for (; last - first >= 4; first += 4) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first + 2));
+        // Within each 128-bit half: the values of one Integer from v0 and one
+        // from v1, and likewise for the pointers.  The order does not matter.
+        __m256i values = _mm256_unpacklo_epi64(v0, v1);
+        __m256i sum = _mm256_add_epi64(acc, values);
+        overflow = _mm256_or_si256(overflow, _mm256_and_si256(_mm256_xor_si256(acc, sum), _mm256_xor_si256(values, sum)));
+        bigs = _mm256_or_si256(bigs, _mm256_unpackhi_epi64(v0, v1));
+        acc = sum;
+    }
+    if (_mm256_movemask_pd(_mm256_castsi256_pd(overflow)) != 0 || !_mm256_testz_si256(bigs, bigs))
+        return false;
+
+    std::int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    std::int64_t rest;
+    if (!scalar_small_sum(first, last, rest))
+        return false;
+    result = rest;
+    for (std::int64_t lane : lanes)
+        if (!checked_add(result, lane, result))
+            return false;
+    return true;
+}
+
+using Kernel = bool (*)(Integer const*, Integer const*, std::int64_t&);
+
+Kernel select_sum_kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return avx2_small_sum;
+    if (__builtin_cpu_supports("sse2"))
+        return sse_small_sum;
+    return scalar_small_sum;
+}
+
+Kernel const sum_kernel = select_sum_kernel();
+
+bool small_sum(Integer const* first, Integer const* last, std::int64_t& result) {
+    return sum_kernel(first, last, result);
+}
+
+#else
+
+bool small_sum(Integer const* first, Integer const* last, std::int64_t& result) {
+    return scalar_small_sum(first, last, result);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef CHAPTER_20_CHECKED_ARITHMETIC_HPP
+#define CHAPTER_20_CHECKED_ARITHMETIC_HPP
+
+#include "integer.hpp"
+#include <cstdint>
+
+// Sums and products over whole ranges of Integers, for the common case where
+// every value and every intermediate result fits in 64 bits.  If that is not
+// the case, the functions return false and leave result alone; the caller
+// should then fall back to ordinary Integer arithmetic, which is always exact.
+//
+// On x86 processors the sums are done with AVX2 or SSE2 instructions if the
+// processor has them; which version to use is decided once, when the program
+// starts.  Elsewhere a plain loop is used.
+bool small_sum(Integer const* first, Integer const* last, std::int64_t& result);
+bool small_product(Integer const* first, Integer const* last, std::int64_t& result);
+
+// The same, one element at a time; the vectorized versions fall back to these
+// and they are useful for comparison.
+bool scalar_small_sum(Integer const* first, Integer const* last, std::int64_t& result);
+
+#endif
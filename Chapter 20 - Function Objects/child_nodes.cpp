@@ -0,0 +1,40 @@
+#include "child_nodes.hpp"
+#include "expression.hpp"
+#include <utility>
+
+// Destroying a node destroys its children, which may have children
+// themselves, and so on: for deeply nested expressions that would run out of
+// stack.  Past a certain depth we therefore don't destroy the children right
+// away but put them aside, and the outermost destructor gets rid of them
+// afterwards.
+int const max_destruction_depth = 1000;
+
+struct DestructionState {
+    int depth = 0;
+    bool draining = false;
+    std::vector<std::shared_ptr<Expression>> deferred;
+};
+
+void destroy_child_nodes(ChildNodes& children) {
+    thread_local DestructionState state;
+
+    if (state.depth >= max_destruction_depth) {
+        for (auto& e : children)
+            state.deferred.push_back(std::move(e));
+        return;
+    }
+
+    state.depth += 1;
+    children.clear();
+    state.depth -= 1;
+
+    if (state.depth > 0 || state.draining)
+        return;
+
+    state.draining = true;
+    while (!state.deferred.empty()) {
+        auto e = std::move(state.deferred.back());
+        state.deferred.pop_back();
+    }
+    state.draining = false;
+}
@@ -0,0 +1,18 @@
+#ifndef CHAPTER_20_CHILD_NODES_HPP
+#define CHAPTER_20_CHILD_NODES_HPP
+
+#include "arena.hpp"
+#include <memory>
+#include <vector>
+
+struct Expression;
+
+// The children of an expression node, allocated in the same arena as the
+// node, if any.
+using ChildNodes = std::vector<std::shared_ptr<Expression>, ArenaAllocator<std::shared_ptr<Expression>>>;
+
+// Destroys the children; to be called from the node's destructor.  For
+// deeply nested expressions this does not recurse without bound.
+void destroy_child_nodes(ChildNodes& children);
+
+#endif
@@ -0,0 +1,11 @@
+#include "evaluation_stack.hpp"
+
+EvaluationStack& get_evaluation_stack() {
+    thread_local EvaluationStack stack;
+    return stack;
+}
+
+Integer call_operation(Operation const& operation, Arguments args) {
+    std::vector<Integer> const copy(args.begin(), args.end());
+    return operation(Arguments(copy.data(), copy.data() + copy.size()));
+}
@@ -0,0 +1,95 @@
+#ifndef CHAPTER_20_EVALUATION_STACK_HPP
+#define CHAPTER_20_EVALUATION_STACK_HPP
+
+#include "arguments.hpp"
+#include "integer.hpp"
+#include "symbol_table.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Scratch space for the arguments of the calls that are currently being
+// evaluated, and for the values of the variables that are in scope.  The
+// storage is kept between evaluations, so once it has grown large enough,
+// evaluating an expression does not allocate.
+class EvaluationStack {
+    std::vector<Integer> values;
+    // Where the values of each scope start, innermost at the back.
+    std::vector<std::size_t> scopes;
+
+public:
+    // Everything pushed while a Frame is alive is popped again when it is
+    // destroyed, and every scope it opened is closed, even if evaluation is
+    // cut short by an exception.  Positions on the stack are as given by
+    // size; evaluate_tree, which does not recurse, uses a single Frame for a
+    // whole expression and keeps track of where the values of each call and
+    // let begin.
+    class Frame {
+        EvaluationStack& stack;
+        std::size_t base;
+        std::size_t scope_base;
+
+    public:
+        explicit Frame(EvaluationStack& stack)
+            : stack(stack), base(stack.values.size()), scope_base(stack.scopes.size()) {}
+        Frame(Frame const&) = delete;
+        ~Frame() {
+            stack.values.resize(base);
+            if (stack.scopes.size() != scope_base)
+                stack.scopes.resize(scope_base);
+        }
+
+        std::size_t size() const { return stack.values.size(); }
+
+        void push(Integer value) { stack.values.push_back(std::move(value)); }
+
+        // Replaces the values from the given position up by a single value,
+        // which may have been computed from them.
+        void replace(std::size_t position, Integer value) {
+            stack.values.resize(position);
+            stack.values.push_back(std::move(value));
+        }
+
+        // Makes the values from the given position up the innermost scope.
+        // The first of them is slot 0.
+        void open_scope(std::size_t position) { stack.scopes.push_back(position); }
+
+        // Closes the innermost scope, replacing its values and the value on
+        // top of them, the result of the scope's body, by that result.
+        void close_scope() {
+            std::size_t const position = stack.scopes.back();
+            stack.scopes.pop_back();
+            replace(position, pop());
+        }
+
+        // The values from the given position up; only valid until the next
+        // push.  An operation that is not a builtin may evaluate another
+        // expression, which pushes onto the same stack, so it must be called
+        // through call_operation rather than be handed this view.
+        Arguments arguments(std::size_t position) const {
+            Integer const* data = stack.values.data();
+            return {data + position, data + stack.values.size()};
+        }
+
+        Integer pop() {
+            Integer value = std::move(stack.values.back());
+            stack.values.pop_back();
+            return value;
+        }
+    };
+
+    // A depth of 0 means the innermost scope, 1 the one around it, and so on.
+    Integer const& variable(int depth, int slot) const {
+        return values[scopes[scopes.size() - 1 - depth] + slot];
+    }
+};
+
+// Each thread has its own stack.
+EvaluationStack& get_evaluation_stack();
+
+// Calls an operation that is not a builtin with a copy of args, which may be a
+// view of the evaluation stack: if the operation evaluates an expression of
+// its own, the stack can grow and move its values elsewhere.
+Integer call_operation(Operation const& operation, Arguments args);
+
+#endif
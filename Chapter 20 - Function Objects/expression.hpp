@@ -1,13 +1,41 @@
 #ifndef CHAPTER_20_EXPRESSION_HPP
 #define CHAPTER_20_EXPRESSION_HPP
 
+#include "integer.hpp"
 #include "symbol_table.hpp"
+#include <cstddef>
+#include <memory>
 #include <ostream>
 
+struct Program;
+struct FoldStatistics;
+
 struct Expression {
+    // Lists and lets have children; every other kind of expression is a
+    // leaf.  The walks in tree_walk.hpp tell them apart by this, which is
+    // cheaper than a dynamic_cast.
+    enum class Shape { leaf, list, let };
+    virtual Shape shape() const { return Shape::leaf; }
+
     virtual void print(std::ostream& out) const = 0;
 
-    virtual int evaluate(SymbolTable const& symbol_table) const = 0;
+    // Expressions with the same structure have the same hash, no matter how
+    // they were written down.
+    virtual std::size_t hash() const = 0;
+
+    // Resolves whatever the expression can look up in the symbol table ahead
+    // of time.  Binding is only a cache: evaluating an unbound expression, or
+    // one bound against a table that has changed since, still works.
+    virtual void bind(SymbolTable const& symbol_table) const = 0;
+
+    virtual Integer evaluate(SymbolTable const& symbol_table) const = 0;
+
+    virtual void compile(Program& program) const = 0;
+
+    // Replaces calls to pure operations whose arguments are all constants by
+    // their results.  Returns the expression that should take this one's
+    // place, or a null pointer if this one can stay.
+    virtual std::shared_ptr<Expression> fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) = 0;
 
     virtual ~Expression() = default;
 };
@@ -0,0 +1,253 @@
+#include "flat_expression.hpp"
+#include "evaluation_stack.hpp"
+#include "let_expr.hpp"
+#include "list_expr.hpp"
+#include "number_expr.hpp"
+#include "profiler.hpp"
+#include "tree_walk.hpp"
+#include "variable_expr.hpp"
+#include <stdexcept>
+#include <typeinfo>
+#include <unordered_map>
+
+FlatExpression::FlatExpression(Expression const& expr) {
+    assign(expr);
+}
+
+void FlatExpression::add_node(NodeKind kind, std::int64_t payload, std::uint32_t extra) {
+    kinds.push_back(kind);
+    payloads.push_back(payload);
+    extras.push_back(extra);
+}
+
+// A node still to be flattened: either an expression, possibly at the head of
+// a list, or the name of a variable of a let.
+struct PendingNode {
+    Expression const* expr;
+    bool head;
+    SymbolId name;
+};
+
+// Each node is added when it is taken from the queue, and its children are
+// queued right away, so they get consecutive indices.  There is no recursion,
+// so arbitrarily deep expressions can be flattened.
+void FlatExpression::assign(Expression const& expr) {
+    kinds.clear();
+    payloads.clear();
+    extras.clear();
+    big_numbers.clear();
+    function_names.clear();
+    functions.clear();
+    bound_generation = 0;
+
+    std::unordered_map<SymbolId, std::size_t> function_indices;
+    std::vector<PendingNode> queue{{&expr, false, 0}};
+    for (std::size_t i = 0; i < queue.size(); ++i) {
+        PendingNode const node = queue[i];
+        std::int64_t const first_child = queue.size();
+
+        if (!node.expr) {
+            add_node(NodeKind::name, 0, node.name);
+        }
+        else if (auto number = dynamic_cast<NumberExpr const*>(node.expr)) {
+            if (number->get_value().is_small()) {
+                add_node(NodeKind::number, number->get_value().get_small(), 0);
+            } else {
+                add_node(NodeKind::big_number, big_numbers.size(), 0);
+                big_numbers.push_back(number->get_value());
+            }
+        }
+        else if (auto variable = dynamic_cast<VariableExpr const*>(node.expr)) {
+            if (node.head) {
+                auto it = function_indices.emplace(variable->get_symbol(), function_names.size()).first;
+                if (it->second == function_names.size())
+                    function_names.push_back(variable->get_symbol());
+                add_node(NodeKind::function, it->second, variable->get_symbol());
+            } else {
+                std::int64_t location = -1;
+                if (variable->is_bound())
+                    location = std::int64_t(variable->get_depth()) << 32 | std::uint32_t(variable->get_slot());
+                add_node(NodeKind::variable, location, variable->get_symbol());
+            }
+        }
+        else if (auto list = dynamic_cast<ListExpr const*>(node.expr)) {
+            add_node(NodeKind::list, first_child, list->size());
+            for (std::size_t j = 0; j < list->size(); ++j)
+                queue.push_back({list->get_element(j).get(), j == 0, 0});
+        }
+        else {
+            auto& let = dynamic_cast<LetExpr const&>(*node.expr);
+            add_node(NodeKind::let, first_child, 2 * let.variable_count() + 1);
+            for (std::size_t j = 0; j < let.variable_count(); ++j) {
+                queue.push_back({nullptr, false, let.get_name(j)});
+                queue.push_back({&let.get_value(j), false, 0});
+            }
+            queue.push_back({&let.get_body(), false, 0});
+        }
+    }
+}
+
+std::size_t FlatExpression::size() const {
+    return kinds.size();
+}
+
+// A list or let that print or evaluate is part way through, and the child
+// it goes on with.  Like evaluate_tree, these keep them on a WalkStack
+// rather than recursing, so arbitrarily deep expressions can be walked.
+struct FlatStep {
+    std::size_t node;
+    std::size_t next;
+    // Where the values of the list's arguments, or the let's variables,
+    // start on the evaluation stack.
+    std::size_t position;
+};
+
+void FlatExpression::print(std::ostream& out) const {
+    WalkStack<FlatStep> walk;
+    auto& steps = *walk;
+    auto visit = [&](std::size_t node) {
+        switch (kinds[node]) {
+        case NodeKind::number:
+            out << payloads[node];
+            break;
+        case NodeKind::big_number:
+            out << big_numbers[payloads[node]];
+            break;
+        case NodeKind::variable:
+        case NodeKind::function:
+        case NodeKind::name:
+            out << symbol_name(extras[node]);
+            break;
+        case NodeKind::list:
+            out << '(';
+            steps.push_back({node, std::size_t(payloads[node]), 0});
+            break;
+        case NodeKind::let:
+            out << "(let (";
+            steps.push_back({node, std::size_t(payloads[node]), 0});
+            break;
+        }
+    };
+
+    visit(0);
+    while (!steps.empty()) {
+        auto& step = steps.back();
+        std::size_t const first = payloads[step.node];
+        std::size_t const end = first + extras[step.node];
+        std::size_t const i = step.next;
+        if (i == end) {
+            out << ')';
+            steps.pop_back();
+            continue;
+        }
+
+        // Each variable of a let is printed as (name value), and the
+        // variables are followed by the body.
+        if (kinds[step.node] == NodeKind::list) {
+            if (i != first)
+                out << ' ';
+        }
+        else if (i == end - 1) {
+            out << (i != first ? ")) " : ") ");
+        }
+        else if (kinds[i] == NodeKind::name) {
+            out << (i != first ? ") (" : "(");
+        }
+        else {
+            out << ' ';
+        }
+        step.next += 1;
+        visit(i);
+    }
+}
+
+void FlatExpression::resolve(SymbolTable const& symbol_table) const {
+    functions.clear();
+    for (auto name : function_names)
+        functions.push_back(symbol_table.find_symbol(symbol_name(name)));
+    bound_generation = symbol_table.get_generation();
+}
+
+void FlatExpression::bind(SymbolTable const& symbol_table) const {
+    resolve(symbol_table);
+}
+
+// The same steps as evaluate_tree for each kind of node, in the same order,
+// so that the same errors come out.
+Integer FlatExpression::evaluate(SymbolTable const& symbol_table) const {
+    if (bound_generation != symbol_table.get_generation())
+        resolve(symbol_table);
+
+    EvaluationStack::Frame frame(get_evaluation_stack());
+    WalkStack<FlatStep> walk;
+    auto& steps = *walk;
+    auto visit = [&](std::size_t node) {
+        std::size_t const first = payloads[node];
+        switch (kinds[node]) {
+        case NodeKind::number:
+            frame.push(payloads[node]);
+            return;
+        case NodeKind::big_number:
+            frame.push(big_numbers[payloads[node]]);
+            return;
+        case NodeKind::variable:
+            if (payloads[node] < 0)
+                throw std::runtime_error{"unbound variable " + symbol_name(extras[node])};
+            frame.push(get_evaluation_stack().variable(payloads[node] >> 32, payloads[node] & 0xffffffff));
+            return;
+        case NodeKind::list:
+            if (extras[node] == 0)
+                throw std::runtime_error{"evaluating empty list"};
+            // The first child names the operation.
+            steps.push_back({node, first + 1, frame.size()});
+            return;
+        case NodeKind::let:
+            steps.push_back({node, first, frame.size()});
+            return;
+        case NodeKind::function:
+        case NodeKind::name:
+            break;
+        }
+        throw std::logic_error{"evaluating a name"};
+    };
+
+    visit(0);
+    while (!steps.empty()) {
+        auto& step = steps.back();
+        std::size_t const first = payloads[step.node];
+        std::size_t const end = first + extras[step.node];
+        if (step.next < end) {
+            std::size_t const i = step.next++;
+            if (kinds[i] == NodeKind::name)
+                continue;
+            if (kinds[step.node] == NodeKind::let && i == end - 1)
+                frame.open_scope(step.position);
+            visit(i);
+            continue;
+        }
+
+        if (kinds[step.node] == NodeKind::let) {
+            frame.close_scope();
+            steps.pop_back();
+            continue;
+        }
+
+        auto const args = frame.arguments(step.position);
+        if (kinds[first] != NodeKind::function)
+            throw std::bad_cast{};
+        auto const symbol = functions[payloads[first]];
+        auto const& function = symbol ? symbol->operation : symbol_table.at(symbol_name(extras[first]));
+        ProfiledCall profiled(extras[first], args.size());
+        if (symbol && symbol->builtin != BuiltinKind::none)
+            frame.replace(step.position, call_builtin(symbol->builtin, args));
+        else
+            frame.replace(step.position, call_operation(function, args));
+        steps.pop_back();
+    }
+    return frame.pop();
+}
+
+std::ostream& operator<<(std::ostream& os, FlatExpression const& expr) {
+    expr.print(os);
+    return os;
+}
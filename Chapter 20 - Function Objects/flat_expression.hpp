@@ -0,0 +1,82 @@
+#ifndef CHAPTER_20_FLAT_EXPRESSION_HPP
+#define CHAPTER_20_FLAT_EXPRESSION_HPP
+
+#include "expression.hpp"
+#include "integer.hpp"
+#include "interner.hpp"
+#include "symbol_table.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// The kinds of node a FlatExpression can hold.  Unlike Expression, the set is
+// closed: code that works on nodes switches on the kind.
+enum class NodeKind : unsigned char {
+    number,
+    big_number,
+    variable,
+    // A name at the head of a list, which refers to the symbol table.
+    function,
+    // The name of a variable of a let.
+    name,
+    list,
+    let
+};
+
+// An expression stored as a few parallel arrays instead of a tree of separate
+// objects.  Node 0 is the root, and the children of every node are stored one
+// after another, in the order the tree was walked breadth first.  A node
+// takes 13 bytes in total, there are no pointers to follow, and walking the
+// nodes walks the arrays more or less in order.
+//
+// What the payload and extra of a node mean depends on its kind:
+//
+//     number      the value                     -
+//     big_number  index into big_numbers        -
+//     variable    depth << 32 | slot, or -1     its SymbolId
+//                 if it is free
+//     function    index into function_names     its SymbolId
+//     name        -                             its SymbolId
+//     list, let   index of the first child      the number of children
+//
+// The children of a let are its names and values, alternately, followed by
+// its body.
+//
+// It behaves just like the Expression it was made from, including the errors
+// evaluating it may give.
+class FlatExpression {
+    std::vector<NodeKind> kinds;
+    std::vector<std::int64_t> payloads;
+    std::vector<std::uint32_t> extras;
+    std::vector<Integer> big_numbers;
+    std::vector<SymbolId> function_names;
+
+    // The symbols the function names referred to in the table with the given
+    // generation; see ListExpr.
+    mutable std::vector<SymbolTable::Symbol const*> functions;
+    mutable unsigned long long bound_generation = 0;
+
+    void add_node(NodeKind kind, std::int64_t payload, std::uint32_t extra);
+    void resolve(SymbolTable const& symbol_table) const;
+
+public:
+    FlatExpression() = default;
+    explicit FlatExpression(Expression const& expr);
+
+    // Replaces the contents by a flattened copy of expr.  The memory the
+    // arrays already have is reused.
+    void assign(Expression const& expr);
+
+    std::size_t size() const;
+
+    void print(std::ostream& out) const;
+
+    void bind(SymbolTable const& symbol_table) const;
+
+    Integer evaluate(SymbolTable const& symbol_table) const;
+};
+
+std::ostream& operator<<(std::ostream& os, FlatExpression const& expr);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef CHAPTER_20_HASH_HPP
+#define CHAPTER_20_HASH_HPP
+
+#include <cstddef>
+
+// Mixes value into seed, in the same way as Boost's hash_combine.
+inline std::size_t hash_combine(std::size_t seed, std::size_t value) {
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+#endif
@@ -0,0 +1,341 @@
+#include "integer.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Magnitudes are stored as base-2^32 digits ("limbs"), least significant
+// first, without leading zeroes.  Zero is the empty vector.
+using Limbs = std::vector<std::uint32_t>;
+
+struct BigInt {
+    bool negative;
+    Limbs magnitude;
+};
+
+Limbs limbs_of(std::uint64_t value) {
+    Limbs limbs;
+    while (value != 0) {
+        limbs.push_back(static_cast<std::uint32_t>(value));
+        value >>= 32;
+    }
+    return limbs;
+}
+
+void trim(Limbs& a) {
+    while (!a.empty() && a.back() == 0)
+        a.pop_back();
+}
+
+int compare(Limbs const& a, Limbs const& b) {
+    if (a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+    for (auto i = a.size(); i-- > 0;)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+Limbs add(Limbs const& a, Limbs const& b) {
+    Limbs const& longer = a.size() >= b.size() ? a : b;
+    Limbs const& shorter = a.size() >= b.size() ? b : a;
+    Limbs result(longer.size() + 1);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < longer.size(); ++i) {
+        carry += longer[i];
+        if (i < shorter.size())
+            carry += shorter[i];
+        result[i] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    result.back() = static_cast<std::uint32_t>(carry);
+    trim(result);
+    return result;
+}
+
+// Requires a >= b.
+Limbs subtract(Limbs const& a, Limbs const& b) {
+    Limbs result(a.size());
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        std::int64_t d = static_cast<std::int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+        borrow = d < 0;
+        result[i] = static_cast<std::uint32_t>(d + (borrow << 32));
+    }
+    trim(result);
+    return result;
+}
+
+Limbs multiply(Limbs const& a, Limbs const& b) {
+    if (a.empty() || b.empty())
+        return {};
+    Limbs result(a.size() + b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        std::uint64_t carry = 0;
+        for (std::size_t j = 0; j < b.size(); ++j) {
+            carry += static_cast<std::uint64_t>(a[i]) * b[j] + result[i + j];
+            result[i + j] = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        result[i + b.size()] = static_cast<std::uint32_t>(carry);
+    }
+    trim(result);
+    return result;
+}
+
+// Divides a in place by a single limb and returns the remainder.
+std::uint32_t divide_in_place(Limbs& a, std::uint32_t divisor) {
+    std::uint64_t remainder = 0;
+    for (auto i = a.size(); i-- > 0;) {
+        std::uint64_t current = (remainder << 32) | a[i];
+        a[i] = static_cast<std::uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    trim(a);
+    return static_cast<std::uint32_t>(remainder);
+}
+
+int leading_zeroes(std::uint32_t x) {
+    int n = 0;
+    for (std::uint32_t bit = 1u << 31; bit && !(x & bit); bit >>= 1)
+        ++n;
+    return n;
+}
+
+// Long division, as in Knuth's Algorithm D (TAOCP vol. 2, 4.3.1).  The
+// divisor must not be zero.
+Limbs divide(Limbs const& u, Limbs const& v) {
+    if (compare(u, v) < 0)
+        return {};
+    if (v.size() == 1) {
+        Limbs q = u;
+        divide_in_place(q, v[0]);
+        return q;
+    }
+
+    std::size_t const n = v.size();
+    std::size_t const m = u.size() - n;
+    int const s = leading_zeroes(v.back());
+
+    // Normalize so that the top limb of the divisor has its high bit set,
+    // which keeps the quotient estimates below off by at most two.
+    Limbs vn(n), un(u.size() + 1);
+    for (std::size_t i = n; i-- > 1;)
+        vn[i] = (v[i] << s) | (s ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(v[i - 1]) >> (32 - s)) : 0);
+    vn[0] = v[0] << s;
+    un[u.size()] = s ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(u.back()) >> (32 - s)) : 0;
+    for (std::size_t i = u.size(); i-- > 1;)
+        un[i] = (u[i] << s) | (s ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(u[i - 1]) >> (32 - s)) : 0);
+    un[0] = u[0] << s;
+
+    std::uint64_t const base = 1ull << 32;
+    Limbs q(m + 1);
+    for (std::size_t j = m + 1; j-- > 0;) {
+        std::uint64_t const numerator = (static_cast<std::uint64_t>(un[j + n]) << 32) | un[j + n - 1];
+        std::uint64_t qhat = numerator / vn[n - 1];
+        std::uint64_t rhat = numerator % vn[n - 1];
+        while (qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            qhat -= 1;
+            rhat += vn[n - 1];
+            if (rhat >= base)
+                break;
+        }
+
+        // Multiply and subtract.
+        std::int64_t borrow = 0;
+        std::int64_t t;
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint64_t const p = qhat * vn[i];
+            t = static_cast<std::int64_t>(un[i + j]) - borrow - static_cast<std::int64_t>(p & 0xffffffff);
+            un[i + j] = static_cast<std::uint32_t>(t);
+            borrow = static_cast<std::int64_t>(p >> 32) - (t >> 32);
+        }
+        t = static_cast<std::int64_t>(un[j + n]) - borrow;
+        un[j + n] = static_cast<std::uint32_t>(t);
+
+        // If we subtracted too much, add one divisor back.
+        if (t < 0) {
+            qhat -= 1;
+            std::uint64_t carry = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                carry += static_cast<std::uint64_t>(un[i + j]) + vn[i];
+                un[i + j] = static_cast<std::uint32_t>(carry);
+                carry >>= 32;
+            }
+            un[j + n] += static_cast<std::uint32_t>(carry);
+        }
+        q[j] = static_cast<std::uint32_t>(qhat);
+    }
+    trim(q);
+    return q;
+}
+
+// A signed magnitude, used as the common form for the slow paths.
+struct Wide {
+    bool negative;
+    Limbs magnitude;
+};
+
+Wide widen(std::int64_t value) {
+    // Negating through unsigned arithmetic works for the smallest value too.
+    std::uint64_t const magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value) : value;
+    return {value < 0, limbs_of(magnitude)};
+}
+
+// Lets the helpers below get at the representation.
+struct IntegerAccess {
+    static Wide to_wide(Integer const& value) {
+        if (value.big)
+            return {value.big->negative, value.big->magnitude};
+        return widen(value.small);
+    }
+
+    static Integer from_wide(Wide value) {
+        auto const& m = value.magnitude;
+        if (m.size() <= 2) {
+            std::uint64_t magnitude = 0;
+            if (m.size() > 0)
+                magnitude = m[0];
+            if (m.size() > 1)
+                magnitude |= static_cast<std::uint64_t>(m[1]) << 32;
+            std::uint64_t const max = std::numeric_limits<std::int64_t>::max();
+            if (magnitude <= max)
+                return value.negative ? -static_cast<std::int64_t>(magnitude) : static_cast<std::int64_t>(magnitude);
+            if (value.negative && magnitude == max + 1)
+                return std::numeric_limits<std::int64_t>::min();
+        }
+        Integer result;
+        result.big = new BigInt{value.negative, std::move(value.magnitude)};
+        return result;
+    }
+
+    static BigInt const* big(Integer const& value) {
+        return value.big;
+    }
+};
+
+Wide add(Wide const& a, Wide const& b) {
+    if (a.negative == b.negative)
+        return {a.negative, add(a.magnitude, b.magnitude)};
+    if (compare(a.magnitude, b.magnitude) >= 0)
+        return {a.negative, subtract(a.magnitude, b.magnitude)};
+    return {b.negative, subtract(b.magnitude, a.magnitude)};
+}
+
+Wide negate(Wide a) {
+    a.negative = !a.negative && !a.magnitude.empty();
+    return a;
+}
+
+BigInt* Integer::copy(BigInt const& value) {
+    return new BigInt(value);
+}
+
+void Integer::release() {
+    delete big;
+    big = nullptr;
+}
+
+Integer Integer::slow_add(Integer const& lhs, Integer const& rhs) {
+    return IntegerAccess::from_wide(add(IntegerAccess::to_wide(lhs), IntegerAccess::to_wide(rhs)));
+}
+
+Integer Integer::slow_subtract(Integer const& lhs, Integer const& rhs) {
+    return IntegerAccess::from_wide(add(IntegerAccess::to_wide(lhs), negate(IntegerAccess::to_wide(rhs))));
+}
+
+Integer Integer::slow_multiply(Integer const& lhs, Integer const& rhs) {
+    auto const a = IntegerAccess::to_wide(lhs);
+    auto const b = IntegerAccess::to_wide(rhs);
+    return IntegerAccess::from_wide({a.negative != b.negative, multiply(a.magnitude, b.magnitude)});
+}
+
+Integer Integer::slow_divide(Integer const& lhs, Integer const& rhs) {
+    auto const a = IntegerAccess::to_wide(lhs);
+    auto const b = IntegerAccess::to_wide(rhs);
+    if (b.magnitude.empty())
+        throw std::domain_error{"division by zero"};
+    return IntegerAccess::from_wide({a.negative != b.negative, divide(a.magnitude, b.magnitude)});
+}
+
+Integer Integer::parse(StringRef digits) {
+    // Nine decimal digits at a time always fit in a limb.
+    Limbs magnitude;
+    std::size_t i = 0;
+    while (i < digits.size()) {
+        std::uint32_t chunk = 0;
+        std::uint32_t scale = 1;
+        for (int k = 0; k < 9 && i < digits.size(); ++k, ++i) {
+            if (digits[i] < '0' || digits[i] > '9')
+                throw std::invalid_argument{"not a number"};
+            chunk = chunk * 10 + (digits[i] - '0');
+            scale *= 10;
+        }
+        std::uint64_t carry = chunk;
+        for (auto& limb : magnitude) {
+            carry += static_cast<std::uint64_t>(limb) * scale;
+            limb = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        if (carry)
+            magnitude.push_back(static_cast<std::uint32_t>(carry));
+    }
+    return IntegerAccess::from_wide({false, std::move(magnitude)});
+}
+
+int Integer::sign() const {
+    if (big)
+        return big->negative ? -1 : 1;
+    return (small > 0) - (small < 0);
+}
+
+std::string Integer::to_string() const {
+    if (!big)
+        return std::to_string(small);
+
+    // Peel off nine decimal digits at a time, least significant first.
+    Limbs magnitude = big->magnitude;
+    std::vector<std::uint32_t> chunks;
+    while (!magnitude.empty())
+        chunks.push_back(divide_in_place(magnitude, 1000000000));
+
+    std::string result = big->negative ? "-" : "";
+    result += std::to_string(chunks.back());
+    for (auto i = chunks.size() - 1; i-- > 0;) {
+        auto const digits = std::to_string(chunks[i]);
+        result.append(9 - digits.size(), '0');
+        result += digits;
+    }
+    return result;
+}
+
+std::size_t Integer::hash() const {
+    if (!big)
+        return std::hash<std::int64_t>{}(small);
+    std::size_t seed = big->negative;
+    for (auto limb : big->magnitude)
+        seed = hash_combine(seed, limb);
+    return seed;
+}
+
+bool operator==(Integer const& lhs, Integer const& rhs) {
+    auto const a = IntegerAccess::big(lhs);
+    auto const b = IntegerAccess::big(rhs);
+    if (!a && !b)
+        return lhs.get_small() == rhs.get_small();
+    // Every value has a single representation, so a big value never equals
+    // a small one.
+    return a && b && a->negative == b->negative && a->magnitude == b->magnitude;
+}
+
+bool operator!=(Integer const& lhs, Integer const& rhs) {
+    return !(lhs == rhs);
+}
+
+std::ostream& operator<<(std::ostream& os, Integer const& value) {
+    if (value.is_small())
+        return os << value.get_small();
+    return os << value.to_string();
+}
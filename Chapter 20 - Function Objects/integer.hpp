@@ -0,0 +1,156 @@
+#ifndef CHAPTER_20_INTEGER_HPP
+#define CHAPTER_20_INTEGER_HPP
+
+#include "string_ref.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <string>
+
+// Adds, subtracts or multiplies two 64-bit integers, returning false instead
+// if the result does not fit.
+inline bool checked_add(std::int64_t a, std::int64_t b, std::int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(a, b, &result);
+#else
+    if (b > 0 ? a > std::numeric_limits<std::int64_t>::max() - b : a < std::numeric_limits<std::int64_t>::min() - b)
+        return false;
+    result = a + b;
+    return true;
+#endif
+}
+
+inline bool checked_subtract(std::int64_t a, std::int64_t b, std::int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_sub_overflow(a, b, &result);
+#else
+    if (b < 0 ? a > std::numeric_limits<std::int64_t>::max() + b : a < std::numeric_limits<std::int64_t>::min() + b)
+        return false;
+    result = a - b;
+    return true;
+#endif
+}
+
+inline bool checked_multiply(std::int64_t a, std::int64_t b, std::int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(a, b, &result);
+#else
+    if (a != 0 && b != 0) {
+        std::int64_t const max = std::numeric_limits<std::int64_t>::max();
+        std::int64_t const min = std::numeric_limits<std::int64_t>::min();
+        if (a > 0 ? (b > 0 ? a > max / b : b < min / a) : (b > 0 ? a < min / b : b < max / a))
+            return false;
+    }
+    result = a * b;
+    return true;
+#endif
+}
+
+struct BigInt;
+
+// An integer of any size.  Values that fit in 64 bits are stored inline, and
+// arithmetic on them costs little more than on a plain std::int64_t: only
+// when a result does not fit is a BigInt allocated on the heap.  Results that
+// fit again are always stored inline, so each value has one representation.
+//
+// The layout is relied upon by the vectorized kernels in
+// checked_arithmetic.cpp: the inline value comes first, then the pointer,
+// which is null for inline values.
+class Integer {
+    std::int64_t small;
+    BigInt* big;
+
+    friend struct IntegerAccess;
+
+    static Integer slow_add(Integer const& lhs, Integer const& rhs);
+    static Integer slow_subtract(Integer const& lhs, Integer const& rhs);
+    static Integer slow_multiply(Integer const& lhs, Integer const& rhs);
+    static Integer slow_divide(Integer const& lhs, Integer const& rhs);
+
+    static BigInt* copy(BigInt const& value);
+    void release();
+
+public:
+    Integer() : small(0), big(nullptr) {}
+    Integer(std::int64_t value) : small(value), big(nullptr) {}
+
+    // Copies and moves are inline too, so that passing small values around
+    // stays cheap.
+    Integer(Integer const& other) : small(other.small), big(other.big ? copy(*other.big) : nullptr) {}
+    // Moves cannot throw, so a std::vector<Integer> that grows moves its
+    // elements rather than copying them.
+    Integer(Integer&& other) noexcept : small(other.small), big(other.big) { other.big = nullptr; }
+
+    Integer& operator=(Integer const& other) {
+        if (!big && !other.big)
+            small = other.small;
+        else if (this != &other)
+            *this = Integer(other);
+        return *this;
+    }
+
+    Integer& operator=(Integer&& other) noexcept {
+        if (this != &other) {
+            if (big)
+                release();
+            small = other.small;
+            big = other.big;
+            other.big = nullptr;
+        }
+        return *this;
+    }
+    ~Integer() { if (big) release(); }
+
+    bool is_small() const { return !big; }
+    // Only meaningful if is_small().
+    std::int64_t get_small() const { return small; }
+
+    // Reads a string of decimal digits.
+    static Integer parse(StringRef digits);
+
+    int sign() const;
+
+    std::string to_string() const;
+
+    std::size_t hash() const;
+
+    friend Integer operator+(Integer const& lhs, Integer const& rhs) {
+        std::int64_t result;
+        if (!lhs.big && !rhs.big && checked_add(lhs.small, rhs.small, result))
+            return result;
+        return slow_add(lhs, rhs);
+    }
+
+    friend Integer operator-(Integer const& lhs, Integer const& rhs) {
+        std::int64_t result;
+        if (!lhs.big && !rhs.big && checked_subtract(lhs.small, rhs.small, result))
+            return result;
+        return slow_subtract(lhs, rhs);
+    }
+
+    friend Integer operator*(Integer const& lhs, Integer const& rhs) {
+        std::int64_t result;
+        if (!lhs.big && !rhs.big && checked_multiply(lhs.small, rhs.small, result))
+            return result;
+        return slow_multiply(lhs, rhs);
+    }
+
+    // Rounds towards zero, like / on ints.  The divisor must not be zero.
+    friend Integer operator/(Integer const& lhs, Integer const& rhs) {
+        if (!lhs.big && !rhs.big && !(rhs.small == -1 && lhs.small == std::numeric_limits<std::int64_t>::min()))
+            return lhs.small / rhs.small;
+        return slow_divide(lhs, rhs);
+    }
+
+    friend Integer operator-(Integer const& value) {
+        return Integer(0) - value;
+    }
+
+    friend bool operator==(Integer const& lhs, Integer const& rhs);
+};
+
+bool operator!=(Integer const& lhs, Integer const& rhs);
+std::ostream& operator<<(std::ostream& os, Integer const& value);
+
+#endif
@@ -0,0 +1,56 @@
+#include "interner.hpp"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using InternMap = std::unordered_map<StringRef, SymbolId, StringRefHash>;
+
+// A deque never moves its elements, so the names stay put and the keys of the
+// maps below can refer to them directly.
+struct Interner {
+    std::mutex mutex;
+    std::deque<std::string> names;
+    InternMap ids;
+};
+
+Interner& get_interner() {
+    static Interner interner;
+    return interner;
+}
+
+SymbolId intern(StringRef name) {
+    // Most lookups are for names that have been seen before; those are served
+    // from a per-thread copy of the table without taking the lock.
+    thread_local InternMap known;
+    auto it = known.find(name);
+    if (it != known.end())
+        return it->second;
+
+    auto& interner = get_interner();
+    std::lock_guard<std::mutex> lock(interner.mutex);
+    auto global = interner.ids.find(name);
+    if (global == interner.ids.end()) {
+        interner.names.emplace_back(name);
+        StringRef stored = interner.names.back();
+        global = interner.ids.emplace(stored, interner.names.size() - 1).first;
+    }
+    known.emplace(global->first, global->second);
+    return global->second;
+}
+
+std::string const& symbol_name(SymbolId id) {
+    // Names never move once stored, so each thread keeps pointers to all the
+    // names there were when it last looked, and only takes the lock for a
+    // name added since then.
+    thread_local std::vector<std::string const*> known;
+    std::size_t const index = id;
+    if (index < known.size())
+        return *known[index];
+
+    auto& interner = get_interner();
+    std::lock_guard<std::mutex> lock(interner.mutex);
+    for (std::size_t i = known.size(); i < interner.names.size(); ++i)
+        known.push_back(&interner.names[i]);
+    return *known[index];
+}
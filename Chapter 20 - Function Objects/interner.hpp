@@ -0,0 +1,20 @@
+#ifndef CHAPTER_20_INTERNER_HPP
+#define CHAPTER_20_INTERNER_HPP
+
+#include "string_ref.hpp"
+#include <string>
+
+// Names are interned: every distinct name is stored once, and is from then on
+// referred to by a small integer.  Two names are equal exactly when their IDs
+// are, so comparing, hashing and copying them costs no more than for an int.
+//
+// The table is shared by the whole program and may be used from any thread.
+// Looking up a name or ID that a thread has seen before takes no lock.
+using SymbolId = int;
+
+SymbolId intern(StringRef name);
+
+// The reference stays valid until the program ends.
+std::string const& symbol_name(SymbolId id);
+
+#endif
@@ -0,0 +1,79 @@
+#include "let_expr.hpp"
+#include "tree_walk.hpp"
+#include <utility>
+
+LetExpr::LetExpr(Arena* arena)
+    : names(ArenaAllocator<SymbolId>(arena)), children(ChildNodes::allocator_type(arena)) {}
+
+LetExpr::~LetExpr() {
+    destroy_child_nodes(children);
+}
+
+// Variables must all be added before the body is set.
+void LetExpr::add_variable(SymbolId name, std::shared_ptr<Expression> value) {
+    names.push_back(name);
+    children.push_back(std::move(value));
+}
+
+void LetExpr::set_body(std::shared_ptr<Expression> body) {
+    children.push_back(std::move(body));
+}
+
+std::size_t LetExpr::variable_count() const {
+    return names.size();
+}
+
+SymbolId LetExpr::get_name(std::size_t i) const {
+    return names[i];
+}
+
+Expression const& LetExpr::get_value(std::size_t i) const {
+    return *children[i];
+}
+
+Expression const& LetExpr::get_body() const {
+    return *children.back();
+}
+
+std::shared_ptr<Expression> const& LetExpr::get_child(std::size_t i) const {
+    return children[i];
+}
+
+ChildNodes const& LetExpr::get_children() const {
+    return children;
+}
+
+void LetExpr::set_child(std::size_t i, std::shared_ptr<Expression> expr) {
+    children[i] = std::move(expr);
+}
+
+Expression::Shape LetExpr::shape() const {
+    return Shape::let;
+}
+
+// Like those of ListExpr, the members that walk the tree leave it to the
+// functions in tree_walk.hpp.
+
+void LetExpr::print(std::ostream& out) const {
+    print_tree(*this, out);
+}
+
+std::size_t LetExpr::hash() const {
+    return hash_tree(*this);
+}
+
+void LetExpr::bind(SymbolTable const& symbol_table) const {
+    bind_tree(*this, symbol_table);
+}
+
+Integer LetExpr::evaluate(SymbolTable const& symbol_table) const {
+    return evaluate_tree(*this, symbol_table);
+}
+
+void LetExpr::compile(Program& program) const {
+    compile_tree(*this, program);
+}
+
+std::shared_ptr<Expression> LetExpr::fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) {
+    return fold_tree(*this, symbol_table, statistics);
+}
@@ -0,0 +1,51 @@
+#ifndef CHAPTER_20_LET_EXPR_HPP
+#define CHAPTER_20_LET_EXPR_HPP
+
+#include "expression.hpp"
+#include "arena.hpp"
+#include "child_nodes.hpp"
+#include "interner.hpp"
+#include <memory>
+#include <vector>
+
+// (let ((name value) ...) body)
+//
+// The values are evaluated first, outside the scope of the names, and are
+// then available to the body under those names.
+class LetExpr : public Expression {
+    std::vector<SymbolId, ArenaAllocator<SymbolId>> names;
+    // The values, in the order of the names, followed by the body.
+    ChildNodes children;
+
+public:
+    explicit LetExpr(Arena* arena = nullptr);
+    ~LetExpr();
+
+    void add_variable(SymbolId name, std::shared_ptr<Expression> value);
+    void set_body(std::shared_ptr<Expression> body);
+
+    std::size_t variable_count() const;
+    SymbolId get_name(std::size_t i) const;
+    Expression const& get_value(std::size_t i) const;
+    Expression const& get_body() const;
+    // The values followed by the body, for sharing them with another node.
+    std::shared_ptr<Expression> const& get_child(std::size_t i) const;
+    ChildNodes const& get_children() const;
+    void set_child(std::size_t i, std::shared_ptr<Expression> expr);
+
+    Shape shape() const override;
+
+    void print(std::ostream& out) const override;
+
+    std::size_t hash() const override;
+
+    void bind(SymbolTable const& symbol_table) const override;
+
+    Integer evaluate(SymbolTable const& symbol_table) const override;
+
+    void compile(Program& program) const override;
+
+    std::shared_ptr<Expression> fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) override;
+};
+
+#endif
@@ -1,111 +1,147 @@
 #include "lexer.hpp"
-#include <cctype>
+#include "char_class.hpp"
+#include <limits>
 #include <stdexcept>
 
 bool isoperator(char c) {
-    std::string const valid_chars = "+*-/!=<>";
-    return valid_chars.find(c) != std::string::npos;
+    return has_class(c, char_operator);
 }
 
-Lexer::Lexer(std::istream& is) : input_stream(is) {}
+bool append_digit(std::int64_t& number, char digit) {
+    int const d = digit - '0';
+    if (number > (std::numeric_limits<std::int64_t>::max() - d) / 10)
+        return false;
+    number = number * 10 + d;
+    return true;
+}
+
+Lexer::Lexer(std::istream& is) : input_stream(is), input_buffer(*is.rdbuf()) {}
 
 Token Lexer::extract() {
     ignore_whitespace();
 
     char c;
     if (!peek(c))
-        return {end_of_file_token, ""};
+        return {TokenType::end_of_file, 0};
 
-    if (std::isalpha(c))
+    if (has_class(c, char_letter))
         return lex_name();
-    if (std::isdigit(c))
+    if (has_class(c, char_digit))
         return lex_number();
-    if (isoperator(c))
+    if (has_class(c, char_operator))
         return lex_operator();
 
     ignore();
 
     if (c == '(')
-        return {open_paren_token, "("};
+        return {TokenType::open_paren, 0};
     if (c == ')')
-        return {close_paren_token, ")"};
+        return {TokenType::close_paren, 0};
 
     throw std::runtime_error{"unrecognised character"};
 }
 
+// The digits are still in the buffer, as nothing has been lexed since.
+StringRef Lexer::get_digits(Token) const {
+    return name_buffer;
+}
+
 Lexer::Position Lexer::get_position() const {
-    return current_position;
+    return {line, static_cast<int>(offset - line_start + 1)};
+}
+
+std::size_t Lexer::get_offset() const {
+    return offset;
 }
 
 Lexer::operator bool() const {
     return bool(input_stream);
 }
 
+void Lexer::skip_line() {
+    char c;
+    while (peek(c)) {
+        ignore();
+        if (c == '\n') {
+            newline();
+            return;
+        }
+    }
+}
+
+// Like std::istream::peek, flushes the tied stream before waiting for more
+// input, so that an interactive user sees every result before typing the
+// next expression, and sets eofbit on the stream at the end of the input.
 bool Lexer::peek(char& c) const {
-    int x = input_stream.peek();
-    if (x == std::char_traits<char>::eof())
+    if (input_buffer.in_avail() <= 0 && input_stream.tie())
+        input_stream.tie()->flush();
+    int x = input_buffer.sgetc();
+    if (x == std::char_traits<char>::eof()) {
+        input_stream.setstate(std::ios_base::eofbit);
         return false;
+    }
     c = x;
     return true;
 }
 
+// Only to be called once peek has found a character.
 void Lexer::ignore() {
-    char c;
-    if (!peek(c))
-        throw std::logic_error{"ignoring past end of file"};
-    input_stream.ignore();
-    if (c == '\n') {
-        current_position.line += 1;
-        current_position.column = 1;
-    } else {
-        current_position.column += 1;
-    }
+    input_buffer.sbumpc();
+    ++offset;
 }
 
-bool Lexer::get(char& c) {
-    if (!peek(c))
-        return false;
-    ignore();
-    return true;
+// Called after ignoring a newline.
+void Lexer::newline() {
+    line += 1;
+    line_start = offset;
 }
 
 void Lexer::ignore_whitespace() {
     char c;
-    while (peek(c) && std::isspace(c))
+    while (peek(c) && has_class(c, char_space)) {
         ignore();
+        if (c == '\n')
+            newline();
+    }
 }
 
 Token Lexer::lex_name() {
     char c;
-    std::string name;
-    while (peek(c) && std::isalpha(c)) {
-        name.push_back(c);
+    name_buffer.clear();
+    while (peek(c) && has_class(c, char_letter)) {
+        name_buffer.push_back(c);
         ignore();
     }
 
-    return {name_token, name};
+    return {TokenType::name, intern(name_buffer)};
 }
 
 Token Lexer::lex_number() {
     char c;
-    std::string number;
-    while (peek(c) && std::isdigit(c)) {
-        number.push_back(c);
+    std::int64_t number = 0;
+    bool small = true;
+    std::size_t const start = offset;
+    name_buffer.clear();
+    while (peek(c) && has_class(c, char_digit)) {
+        small = small && append_digit(number, c);
+        name_buffer.push_back(c);
         ignore();
     }
 
-    return {number_token, number};
+    if (!small)
+        return {TokenType::big_number, static_cast<std::int64_t>(start)};
+    return {TokenType::number, number};
 }
 
 Token Lexer::lex_operator() {
     char c;
-    std::string op;
-    while (peek(c) && isoperator(c)) {
-        op.push_back(c);
+    name_buffer.clear();
+    while (peek(c) && has_class(c, char_operator)) {
+        name_buffer.push_back(c);
         ignore();
     }
 
-    return {name_token, op};
+    return {TokenType::name, intern(name_buffer)};
 }
 
 bool operator!(Lexer const& lex) {
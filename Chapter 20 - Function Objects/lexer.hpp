@@ -1,35 +1,67 @@
 #ifndef CHAPTER_20_LEXER_HPP
 #define CHAPTER_20_LEXER_HPP
 
+#include "string_ref.hpp"
 #include "token.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <istream>
 #include <ostream>
+#include <streambuf>
 #include <string>
 
+bool isoperator(char c);
+
+// Adds a decimal digit to the end of number, returning false and leaving
+// number alone if the result does not fit in 64 bits.
+bool append_digit(std::int64_t& number, char digit);
+
+// Reads characters straight from the stream's buffer rather than through
+// std::istream::peek and ignore, which check the state of the stream for every
+// character.  It never reads further than the token it returns, so a Lexer can
+// be kept for as long as the stream is read, or made afresh for every
+// expression.
+//
+// Only whitespace can contain a newline, so that is the only place where the
+// lexer looks for one; everywhere else it just counts characters.
 struct Lexer {
     explicit Lexer(std::istream& is);
     Lexer(Lexer const&) = delete;
 
     Token extract();
+    // The digits of token, which must be the big_number just extracted.
+    StringRef get_digits(Token token) const;
 
     struct Position {
         int line, column;
     };
 
     Position get_position() const;
+    // The number of characters read so far.
+    std::size_t get_offset() const;
 
     explicit operator bool() const;
 
+    // Discards the rest of the current line, including its newline.
+    void skip_line();
+
 private:
     std::istream& input_stream;
+    std::streambuf& input_buffer;
 
-    Position current_position{1, 1};
+    std::size_t offset = 0;
+    int line = 1;
+    // The offset of the first character of the current line.
+    std::size_t line_start = 0;
+
+    // Reused for every name and number, so that lexing one only allocates
+    // when it is longer than any before it.
+    std::string name_buffer;
 
     bool peek(char& c) const;
 
     void ignore();
-
-    bool get(char& c);
+    void newline();
 
     void ignore_whitespace();
 
@@ -0,0 +1,163 @@
+#include "line_evaluator.hpp"
+#include "buffer_lexer.hpp"
+#include "bytecode.hpp"
+#include "parser.hpp"
+#include "profiler.hpp"
+#include <exception>
+#include <utility>
+
+EvaluatorStatistics& operator+=(EvaluatorStatistics& lhs, EvaluatorStatistics const& rhs) {
+    lhs.fold.calls_folded += rhs.fold.calls_folded;
+    lhs.fold.nodes_removed += rhs.fold.nodes_removed;
+    lhs.fold.failed_folds += rhs.fold.failed_folds;
+    lhs.cache.line_hits += rhs.cache.line_hits;
+    lhs.cache.structure_hits += rhs.cache.structure_hits;
+    lhs.cache.misses += rhs.cache.misses;
+    lhs.cache.evictions += rhs.cache.evictions;
+    return lhs;
+}
+
+LineEvaluator::LineEvaluator(SymbolTable const& symbol_table, EvaluationOptions const& options)
+    : symbol_table(symbol_table), options(options) {
+    if (options.cache_bytes > 0)
+        cache.reset(new ResultCache(options.cache_bytes));
+}
+
+LineResult LineEvaluator::evaluate(StringRef line) {
+    if (cache) {
+        cache->check_generation(symbol_table.get_generation());
+        if (auto hit = cache->find_line(line))
+            return *hit;
+    }
+
+    arena.reset();
+
+    std::shared_ptr<Expression> ptr;
+    try {
+        ProfiledPhase parsing(Phase::parse);
+        ptr = profiling() ? parse_profiled(line) : options.use_arena ? parse_expression(line, arena)
+                                                                     : parse_expression(line);
+    }
+    catch (std::exception& e) {
+        LineResult result{false, e.what()};
+        if (cache) {
+            cache->record_miss();
+            cache->insert_line(line, result);
+        }
+        return result;
+    }
+
+    bool cacheable;
+    auto result = evaluate_expression(std::move(ptr), cacheable);
+    if (cacheable)
+        cache->insert_line(line, result);
+    return result;
+}
+
+// Timing every token the parser asks for would mostly time the clock, so the
+// line is lexed in one go first, and that is timed instead.
+std::shared_ptr<Expression> LineEvaluator::parse_profiled(StringRef line) {
+    {
+        ProfiledPhase lexing(Phase::lex);
+        tokenize_all(line, tokens);
+    }
+    return options.use_arena ? parse_expression(tokens, line, arena) : parse_expression(tokens, line);
+}
+
+bool LineEvaluator::evaluate_next(ExpressionReader& reader, LineResult& result) {
+    if (cache)
+        cache->check_generation(symbol_table.get_generation());
+
+    arena.reset();
+
+    std::shared_ptr<Expression> ptr;
+    try {
+        ProfiledPhase parsing(Phase::parse);
+        ptr = options.use_arena ? reader.next(arena) : reader.next();
+    }
+    catch (std::exception& e) {
+        if (cache)
+            cache->record_miss();
+        result = {false, e.what()};
+        return true;
+    }
+
+    if (!ptr)
+        return false;
+    bool cacheable;
+    result = evaluate_expression(std::move(ptr), cacheable);
+    return true;
+}
+
+// Looks for the result of an expression of the same structure in the cache
+// before evaluating the expression itself.  Expressions that call operations
+// which are not pure are never cached, as their results may change from one
+// call to the next.
+LineResult LineEvaluator::evaluate_expression(std::shared_ptr<Expression> ptr, bool& cacheable) {
+    cacheable = false;
+    if (!cache)
+        return evaluate_parsed(std::move(ptr));
+
+    auto const hash = ptr->hash();
+    if (auto hit = cache->find_structure(hash, *ptr)) {
+        cacheable = true;
+        return *hit;
+    }
+
+    cache->record_miss();
+    if (!calls_only_pure(*ptr, symbol_table))
+        return evaluate_parsed(std::move(ptr));
+
+    cacheable = true;
+    if (!cache->note_seen(hash))
+        return evaluate_parsed(std::move(ptr));
+
+    // The canonical form has to be taken now, as folding may change the tree.
+    auto const canonical = canonical_form(*ptr);
+    auto result = evaluate_parsed(std::move(ptr));
+    cache->insert_structure(hash, canonical, result);
+    return result;
+}
+
+LineResult LineEvaluator::evaluate_parsed(std::shared_ptr<Expression> ptr) {
+    try {
+        if (options.fold) {
+            ProfiledPhase folding(Phase::fold);
+            ptr = fold_constants(ptr, symbol_table, fold_statistics);
+        }
+
+        if (options.use_vm) {
+            Program program;
+            {
+                ProfiledPhase compiling(Phase::compile);
+                program = compile(*ptr, symbol_table);
+            }
+            ProfiledPhase evaluating(Phase::evaluate);
+            return {true, vm.run(program, symbol_table).to_string()};
+        }
+
+        if (options.use_flat) {
+            {
+                ProfiledPhase compiling(Phase::compile);
+                flat.assign(*ptr);
+            }
+            ProfiledPhase evaluating(Phase::evaluate);
+            return {true, flat.evaluate(symbol_table).to_string()};
+        }
+
+        ProfiledPhase evaluating(Phase::evaluate);
+        ptr->bind(symbol_table);
+        return {true, ptr->evaluate(symbol_table).to_string()};
+    }
+    catch (std::exception& e) {
+        return {false, e.what()};
+    }
+}
+
+EvaluatorStatistics LineEvaluator::get_statistics() const {
+    EvaluatorStatistics statistics;
+    statistics.fold = fold_statistics;
+    if (cache)
+        statistics.cache = cache->get_statistics();
+    return statistics;
+}
@@ -0,0 +1,67 @@
+#ifndef CHAPTER_20_LINE_EVALUATOR_HPP
+#define CHAPTER_20_LINE_EVALUATOR_HPP
+
+#include "arena.hpp"
+#include "flat_expression.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "result_cache.hpp"
+#include "string_ref.hpp"
+#include "symbol_table.hpp"
+#include "virtual_machine.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+struct EvaluationOptions {
+    bool use_vm = false;
+    bool use_flat = false;
+    bool use_arena = false;
+    bool fold = false;
+    // Zero disables the result cache.
+    std::size_t cache_bytes = 0;
+};
+
+struct EvaluatorStatistics {
+    FoldStatistics fold;
+    CacheStatistics cache;
+};
+
+EvaluatorStatistics& operator+=(EvaluatorStatistics& lhs, EvaluatorStatistics const& rhs);
+
+// Parses and evaluates single lines of input.  Each evaluator keeps its own
+// arena, virtual machine, flat expression and result cache around between
+// lines, so a thread that evaluates many lines should reuse one evaluator for
+// all of them.
+class LineEvaluator {
+    SymbolTable const& symbol_table;
+    EvaluationOptions options;
+    VirtualMachine vm;
+    FlatExpression flat;
+    Arena arena;
+    // Only used while profiling, to lex each line in one go.
+    TokenArray tokens;
+    std::unique_ptr<ResultCache> cache;
+    FoldStatistics fold_statistics;
+
+    std::shared_ptr<Expression> parse_profiled(StringRef line);
+    LineResult evaluate_parsed(std::shared_ptr<Expression> ptr);
+    // Sets cacheable to whether the result may be stored in the cache.
+    LineResult evaluate_expression(std::shared_ptr<Expression> ptr, bool& cacheable);
+
+public:
+    LineEvaluator(SymbolTable const& symbol_table, EvaluationOptions const& options);
+    LineEvaluator(LineEvaluator const&) = delete;
+
+    LineResult evaluate(StringRef line);
+
+    // Reads the next expression from the reader and evaluates it, putting a
+    // parse error into the result like any other.  Returns false once the
+    // reader has run out of expressions.  Only results for expressions of the
+    // same structure can come from the cache, as there are no lines.
+    bool evaluate_next(ExpressionReader& reader, LineResult& result);
+
+    EvaluatorStatistics get_statistics() const;
+};
+
+#endif
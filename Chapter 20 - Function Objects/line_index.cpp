@@ -0,0 +1,24 @@
+#include "line_index.hpp"
+#include <algorithm>
+#include <cstring>
+
+LineIndex::LineIndex(char const* first, char const* last) : first(first), last(last) {}
+
+// std::memchr is vectorized by every C library worth using, so finding the
+// newlines takes far less than a branch per character.
+Lexer::Position LineIndex::position(std::size_t offset) {
+    offset = std::min(offset, static_cast<std::size_t>(last - first));
+    while (indexed < offset) {
+        auto newline = static_cast<char const*>(std::memchr(first + indexed, '\n', offset - indexed));
+        if (!newline) {
+            indexed = offset;
+            break;
+        }
+        newlines.push_back(newline - first);
+        indexed = newline - first + 1;
+    }
+
+    auto const line = std::lower_bound(newlines.begin(), newlines.end(), offset) - newlines.begin();
+    std::size_t const line_start = line == 0 ? 0 : newlines[line - 1] + 1;
+    return {static_cast<int>(line + 1), static_cast<int>(offset - line_start + 1)};
+}
@@ -0,0 +1,26 @@
+#ifndef CHAPTER_20_LINE_INDEX_HPP
+#define CHAPTER_20_LINE_INDEX_HPP
+
+#include "lexer.hpp"
+#include <cstddef>
+#include <vector>
+
+// Turns byte offsets into a buffer into lines and columns, counted the way
+// Lexer counts them.  Lexing only needs the offset, and positions are only
+// needed to report errors, so the newlines are not looked for until a
+// position is asked for, and then only as far as that position.
+class LineIndex {
+    char const* first;
+    char const* last;
+    // The offsets of the newlines found so far, in increasing order.
+    std::vector<std::size_t> newlines;
+    // Everything before this offset has been searched for newlines.
+    std::size_t indexed = 0;
+
+public:
+    LineIndex(char const* first, char const* last);
+
+    Lexer::Position position(std::size_t offset);
+};
+
+#endif
@@ -1,36 +1,146 @@
 #include "list_expr.hpp"
+#include "bytecode.hpp"
 #include "variable_expr.hpp"
-#include <algorithm>
+#include "number_expr.hpp"
+#include "optimizer.hpp"
+#include "evaluation_stack.hpp"
+#include "profiler.hpp"
+#include "tree_walk.hpp"
 #include <iterator>
-#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+ListExpr::ListExpr(Arena* arena) : elements(ChildNodes::allocator_type(arena)) {}
+
+ListExpr::~ListExpr() {
+    destroy_child_nodes(elements);
+}
 
 void ListExpr::add(std::shared_ptr<Expression> expr) {
-    elements.push_back(expr);
+    elements.push_back(std::move(expr));
+}
+
+void ListExpr::reserve(std::size_t size) {
+    elements.reserve(size);
+}
+
+std::size_t ListExpr::size() const {
+    return elements.size();
+}
+
+std::shared_ptr<Expression> const& ListExpr::get_element(std::size_t i) const {
+    return elements[i];
+}
+
+ChildNodes const& ListExpr::get_elements() const {
+    return elements;
 }
 
+void ListExpr::set_element(std::size_t i, std::shared_ptr<Expression> expr) {
+    elements[i] = std::move(expr);
+}
+
+Expression::Shape ListExpr::shape() const {
+    return Shape::list;
+}
+
+// The members that walk the tree leave it to the functions in tree_walk.hpp,
+// which do not recurse, so that there is one walk of each kind to keep right.
+
 void ListExpr::print(std::ostream& out) const {
-    out << '(';
-    bool first = true;
-    for (auto const& e : elements) {
-        if (first)
-            first = false;
-        else
-            out << ' ';
-        e->print(out);
-    }
-    out << ')';
+    print_tree(*this, out);
 }
 
-int ListExpr::evaluate(SymbolTable const& symbol_table) const {
-    if (elements.empty())
-        throw std::runtime_error{"evaluating empty list"};
-    std::vector<int> args;
-    // TODO: Comment on how this works.
-    std::transform(std::begin(elements) + 1, std::end(elements), std::back_inserter(args), [&](std::shared_ptr<Expression> expr) { 
-        return expr->evaluate(symbol_table);
-    });
+std::size_t ListExpr::hash() const {
+    return hash_tree(*this);
+}
 
+void ListExpr::resolve(SymbolTable const& symbol_table) const {
+    callee = nullptr;
+    builtin = BuiltinKind::none;
+    if (!elements.empty())
+        if (auto function_name = dynamic_cast<VariableExpr const*>(elements[0].get()))
+            if (auto symbol = symbol_table.find_symbol(function_name->get_name())) {
+                callee = &symbol->operation;
+                builtin = symbol->builtin;
+            }
+    bound_generation = symbol_table.get_generation();
+}
+
+void ListExpr::bind(SymbolTable const& symbol_table) const {
+    bind_tree(*this, symbol_table);
+}
+
+Integer ListExpr::evaluate(SymbolTable const& symbol_table) const {
+    return evaluate_tree(*this, symbol_table);
+}
+
+Integer ListExpr::call(Arguments args, SymbolTable const& symbol_table) const {
+    if (bound_generation != symbol_table.get_generation())
+        resolve(symbol_table);
+    // A callee was only found if the head is a name.
+    if (callee) {
+        ProfiledCall profiled(static_cast<VariableExpr const&>(*elements[0]).get_symbol(), args.size());
+        return builtin != BuiltinKind::none ? call_builtin(builtin, args) : call_operation(*callee, args);
+    }
+
+    // The name could not be resolved; look it up the slow way so that the
+    // error is the same as it would be without binding.
     auto& function_name = dynamic_cast<VariableExpr&>(*elements[0]);
     auto& function = symbol_table.at(function_name.get_name());
-    return function(args);
+    ProfiledCall profiled(function_name.get_symbol(), args.size());
+    return call_operation(function, args);
+}
+
+void ListExpr::compile(Program& program) const {
+    compile_tree(*this, program);
+}
+
+// The arguments are compiled first so that errors in them are reported
+// before errors in the function name, just like in evaluate.
+void ListExpr::compile_call(Program& program) const {
+    auto function_name = dynamic_cast<VariableExpr const*>(elements[0].get());
+    if (function_name)
+        program.emit_call(function_name->get_symbol(), elements.size() - 1);
+    else
+        program.emit_fail(std::bad_cast{}.what());
+}
+
+std::shared_ptr<Expression> ListExpr::fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) {
+    return fold_tree(*this, symbol_table, statistics);
+}
+
+std::shared_ptr<Expression> ListExpr::fold_call(SymbolTable const& symbol_table, FoldStatistics& statistics) const {
+    if (elements.empty())
+        return {};
+
+    std::vector<Integer> args;
+    for (auto it = std::begin(elements) + 1; it != std::end(elements); ++it) {
+        auto number = dynamic_cast<NumberExpr const*>(it->get());
+        if (!number)
+            return {};
+        args.push_back(number->get_value());
+    }
+
+    auto function_name = dynamic_cast<VariableExpr const*>(elements[0].get());
+    if (!function_name || !symbol_table.is_pure(function_name->get_name()))
+        return {};
+
+    // If the call fails, we leave it in place: the error will then be reported
+    // when the expression is evaluated, rather than now.
+    Integer value;
+    try {
+        value = symbol_table.at(function_name->get_name())(Arguments(args.data(), args.data() + args.size()));
+    }
+    catch (std::exception&) {
+        statistics.failed_folds += 1;
+        return {};
+    }
+
+    // The list, its head, and its (by now constant) arguments are replaced by
+    // a single number.
+    statistics.calls_folded += 1;
+    statistics.nodes_removed += elements.size();
+    return std::make_shared<NumberExpr>(value);
 }
@@ -2,18 +2,63 @@
 #define CHAPTER_20_LIST_EXPR_HPP
 
 #include "expression.hpp"
-#include <vector>
+#include "arguments.hpp"
+#include "arena.hpp"
+#include "child_nodes.hpp"
 #include <memory>
 
 class ListExpr : public Expression {
-    std::vector<std::shared_ptr<Expression>> elements;
+    ChildNodes elements;
+
+    // The operation named by the first element, as found in the symbol table
+    // with the given generation, and which builtin it is, if any.  Because
+    // these are filled in lazily during evaluate, a single ListExpr must not
+    // be evaluated from several threads at once unless it has been bound
+    // first.
+    mutable Operation const* callee = nullptr;
+    mutable BuiltinKind builtin = BuiltinKind::none;
+    mutable unsigned long long bound_generation = 0;
 
 public:
+    explicit ListExpr(Arena* arena = nullptr);
+    ~ListExpr();
+
     void add(std::shared_ptr<Expression> expr);
+    void reserve(std::size_t size);
+
+    std::size_t size() const;
+    std::shared_ptr<Expression> const& get_element(std::size_t i) const;
+    ChildNodes const& get_elements() const;
+    void set_element(std::size_t i, std::shared_ptr<Expression> expr);
+
+    Shape shape() const override;
 
     void print(std::ostream& out) const override;
 
-    int evaluate(SymbolTable const& symbol_table) const override;
+    std::size_t hash() const override;
+
+    // Looks the first element up in the symbol table.
+    void resolve(SymbolTable const& symbol_table) const;
+
+    void bind(SymbolTable const& symbol_table) const override;
+
+    Integer evaluate(SymbolTable const& symbol_table) const override;
+
+    // Calls the operation named by the first element with the values of the
+    // others.
+    Integer call(Arguments args, SymbolTable const& symbol_table) const;
+
+    void compile(Program& program) const override;
+
+    // Emits the call, once the arguments have been compiled.
+    void compile_call(Program& program) const;
+
+    std::shared_ptr<Expression> fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) override;
+
+    // The number the call folds to, once its arguments have been folded, if
+    // they are all numbers and the operation is pure; otherwise a null
+    // pointer.
+    std::shared_ptr<Expression> fold_call(SymbolTable const& symbol_table, FoldStatistics& statistics) const;
 };
 
 #endif
@@ -0,0 +1,88 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(std::string const& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error{"cannot open " + path};
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error{"cannot read " + path};
+    }
+
+    // Only a regular file has a size that can be mapped.  Anything else, such
+    // as a pipe or a terminal, has to be read to the end instead.
+    if (!S_ISREG(info.st_mode)) {
+        char buffer[65536];
+        ssize_t count;
+        while ((count = read(fd, buffer, sizeof buffer)) != 0) {
+            if (count < 0) {
+                close(fd);
+                throw std::runtime_error{"cannot read " + path};
+            }
+            contents.append(buffer, count);
+        }
+        close(fd);
+        first = contents.data();
+        length = contents.size();
+        return;
+    }
+
+    length = info.st_size;
+    // Mapping an empty file fails, but there is nothing to map anyway.
+    if (length > 0) {
+        void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error{"cannot map " + path};
+        }
+        madvise(data, length, MADV_SEQUENTIAL);
+        first = static_cast<char const*>(data);
+    }
+    close(fd);
+}
+
+// Unless the file was read into contents, it is mapped.
+MappedFile::~MappedFile() {
+    if (first && first != contents.data())
+        munmap(const_cast<char*>(first), length);
+}
+
+#else
+
+#include <fstream>
+#include <iterator>
+
+MappedFile::MappedFile(std::string const& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error{"cannot open " + path};
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    first = contents.data();
+    length = contents.size();
+}
+
+MappedFile::~MappedFile() {}
+
+#endif
+
+char const* MappedFile::begin() const {
+    return first;
+}
+
+char const* MappedFile::end() const {
+    return first + length;
+}
+
+std::size_t MappedFile::size() const {
+    return length;
+}
@@ -0,0 +1,28 @@
+#ifndef CHAPTER_20_MAPPED_FILE_HPP
+#define CHAPTER_20_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// The contents of a file, made available as one contiguous buffer.  On POSIX
+// systems a regular file is memory-mapped, so nothing is read until it is
+// used; a pipe or other special file, and any file elsewhere, is read into
+// memory in one go.
+class MappedFile {
+    char const* first = nullptr;
+    std::size_t length = 0;
+    std::string contents;
+
+public:
+    // Throws std::runtime_error if the file cannot be opened.
+    explicit MappedFile(std::string const& path);
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    ~MappedFile();
+
+    char const* begin() const;
+    char const* end() const;
+    std::size_t size() const;
+};
+
+#endif
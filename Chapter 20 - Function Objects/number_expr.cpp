@@ -1,11 +1,33 @@
 #include "number_expr.hpp"
+#include "bytecode.hpp"
+#include "optimizer.hpp"
+#include "hash.hpp"
+#include <utility>
 
-NumberExpr::NumberExpr(int value) : value(value) {}
+NumberExpr::NumberExpr(Integer value) : value(std::move(value)) {}
+
+Integer const& NumberExpr::get_value() const {
+    return value;
+}
 
 void NumberExpr::print(std::ostream& out) const {
     out << value;
 }
 
-int NumberExpr::evaluate(SymbolTable const&) const {
+std::size_t NumberExpr::hash() const {
+    return hash_combine(1, value.hash());
+}
+
+void NumberExpr::bind(SymbolTable const&) const {}
+
+Integer NumberExpr::evaluate(SymbolTable const&) const {
     return value;
 }
+
+void NumberExpr::compile(Program& program) const {
+    program.emit_number(value);
+}
+
+std::shared_ptr<Expression> NumberExpr::fold_constants(SymbolTable const&, FoldStatistics&) {
+    return {};
+}
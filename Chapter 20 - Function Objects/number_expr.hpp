@@ -4,14 +4,24 @@
 #include "expression.hpp"
 
 class NumberExpr : public Expression {
-    int value;
+    Integer value;
 
 public:
-    NumberExpr(int value);
+    NumberExpr(Integer value);
+
+    Integer const& get_value() const;
 
     void print(std::ostream& out) const override;
 
-    int evaluate(SymbolTable const& symbol_table) const override;
+    std::size_t hash() const override;
+
+    void bind(SymbolTable const& symbol_table) const override;
+
+    Integer evaluate(SymbolTable const& symbol_table) const override;
+
+    void compile(Program& program) const override;
+
+    std::shared_ptr<Expression> fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) override;
 };
 
 #endif
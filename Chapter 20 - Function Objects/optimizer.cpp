@@ -0,0 +1,38 @@
+#include "optimizer.hpp"
+#include "let_expr.hpp"
+#include "list_expr.hpp"
+#include "variable_expr.hpp"
+#include <vector>
+
+std::shared_ptr<Expression> fold_constants(std::shared_ptr<Expression> const& expr, SymbolTable const& symbol_table, FoldStatistics& statistics) {
+    auto replacement = expr->fold_constants(symbol_table, statistics);
+    return replacement ? replacement : expr;
+}
+
+bool calls_only_pure(Expression const& expr, SymbolTable const& symbol_table) {
+    std::vector<Expression const*> pending{&expr};
+    while (!pending.empty()) {
+        auto const e = pending.back();
+        pending.pop_back();
+        switch (e->shape()) {
+        case Expression::Shape::leaf:
+            break;
+        case Expression::Shape::list: {
+            auto const& elements = static_cast<ListExpr const*>(e)->get_elements();
+            if (elements.empty())
+                break;
+            auto function_name = dynamic_cast<VariableExpr const*>(elements[0].get());
+            if (!function_name || !symbol_table.is_pure(function_name->get_name()))
+                return false;
+            for (std::size_t i = 1; i < elements.size(); ++i)
+                pending.push_back(elements[i].get());
+            break;
+        }
+        case Expression::Shape::let:
+            for (auto const& child : static_cast<LetExpr const*>(e)->get_children())
+                pending.push_back(child.get());
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef CHAPTER_20_OPTIMIZER_HPP
+#define CHAPTER_20_OPTIMIZER_HPP
+
+#include "expression.hpp"
+#include "symbol_table.hpp"
+#include <cstddef>
+#include <memory>
+
+struct FoldStatistics {
+    std::size_t calls_folded = 0;
+    std::size_t nodes_removed = 0;
+    std::size_t failed_folds = 0;
+};
+
+// Evaluates, ahead of time, every call to a pure operation whose arguments are
+// constant, and returns the simplified expression.  The input expression may
+// be modified in the process.  Calls that throw are left alone so that the
+// error is reported when the result is evaluated.
+//
+// The result is only valid for symbol tables that define the folded
+// operations the same way as the one given here.
+std::shared_ptr<Expression> fold_constants(std::shared_ptr<Expression> const& expr, SymbolTable const& symbol_table, FoldStatistics& statistics);
+
+// Whether every list in the expression calls a pure operation, so that its
+// value depends on nothing but the expression itself.
+bool calls_only_pure(Expression const& expr, SymbolTable const& symbol_table);
+
+#endif
@@ -0,0 +1,108 @@
+#include "parallel_lexer.hpp"
+#include "buffer_lexer.hpp"
+#include "char_class.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Windows are cut into this many chunks per thread.
+std::size_t const chunks_per_job = 4;
+
+// Returns the first whitespace character or parenthesis at or after
+// position, or last.  Parentheses are tokens of a single character, so a
+// token can never go on past one, and cutting before them lets input with no
+// whitespace at all, like ((((1)))), still be split.
+char const* chunk_boundary(char const* position, char const* last) {
+    while (position != last && !has_class(*position, char_space) && *position != '(' && *position != ')')
+        ++position;
+    return position;
+}
+
+// Runs work(i) for every i below count on the given number of threads, which
+// take the next i as soon as they are done with the last.
+template <typename Work>
+void run_parallel(std::size_t count, unsigned jobs, Work const& work) {
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (std::size_t i; (i = next++) < count;)
+            work(i);
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<std::size_t>(jobs, count); ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+ParallelLexer::ParallelLexer(StringRef source, unsigned jobs, std::size_t window_size)
+    : source(source), jobs(std::max(jobs, 1u)), window_size(window_size) {
+    if (this->window_size == 0)
+        this->window_size = (std::size_t(64) << 20) * this->jobs;
+}
+
+bool ParallelLexer::next(TokenArray& tokens) {
+    if (finished)
+        return false;
+
+    char const* const first = source.begin();
+    char const* const last = source.end();
+    char const* const window_first = first + done;
+    char const* const window_last =
+        chunk_boundary(window_first + std::min<std::size_t>(window_size, last - window_first), last);
+
+    // Every chunk but the last starts just before whitespace or a parenthesis.
+    std::size_t const chunk_count = jobs * chunks_per_job;
+    std::size_t const chunk_size = std::max<std::size_t>((window_last - window_first) / chunk_count, 1);
+    std::vector<char const*> bounds{window_first};
+    while (bounds.back() != window_last)
+        bounds.push_back(chunk_boundary(bounds.back() + std::min<std::size_t>(chunk_size, window_last - bounds.back()),
+                                        window_last));
+    if (bounds.size() == 1)
+        bounds.push_back(window_last);
+    chunks.resize(bounds.size() - 1);
+
+    run_parallel(chunks.size(), jobs, [&](std::size_t i) {
+        chunks[i].clear();
+        BufferLexer lexer(bounds[i], bounds[i + 1]);
+        lexer.extract_all(chunks[i]);
+    });
+
+    // Every chunk ends with an end_of_file, of which only the last one in the
+    // buffer is kept, unless a chunk has stopped at an unrecognised character;
+    // then nothing after it is kept.
+    bool const at_end = window_last == last;
+    std::vector<std::size_t> starts{0};
+    std::size_t used = 0;
+    while (used < chunks.size()) {
+        auto const& chunk = chunks[used++];
+        bool const stop = chunk.unrecognised || (at_end && used == chunks.size());
+        starts.push_back(starts.back() + chunk.size() - (stop ? 0 : 1));
+        if (stop) {
+            finished = true;
+            tokens.unrecognised = chunk.unrecognised;
+            break;
+        }
+    }
+
+    if (!finished)
+        tokens.unrecognised = false;
+    tokens.resize(starts.back());
+    run_parallel(used, jobs, [&](std::size_t i) {
+        tokens.copy(starts[i], chunks[i], 0, starts[i + 1] - starts[i], bounds[i] - first);
+    });
+
+    done = window_last - first;
+    finished = finished || at_end;
+    return true;
+}
+
+void ParallelLexer::resume(std::size_t offset) {
+    done = std::min(offset, source.size());
+    finished = false;
+}
+
+void tokenize_parallel(StringRef source, TokenArray& tokens, unsigned jobs) {
+    ParallelLexer lexer(source, jobs, source.size() + 1);
+    lexer.next(tokens);
+}
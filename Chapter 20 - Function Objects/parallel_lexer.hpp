@@ -0,0 +1,49 @@
+#ifndef CHAPTER_20_PARALLEL_LEXER_HPP
+#define CHAPTER_20_PARALLEL_LEXER_HPP
+
+#include "string_ref.hpp"
+#include "token.hpp"
+#include <cstddef>
+#include <vector>
+
+// Lexes a large buffer on several threads, giving the same tokens as
+// tokenize_all.  The buffer is cut into chunks just before a whitespace
+// character or a parenthesis, neither of which can be inside a token, so every
+// chunk can be lexed on its own.  The chunks' tokens are then copied, also in
+// parallel, into one TokenArray, with offsets into the whole buffer, so
+// positions come out the same as well.
+//
+// To keep the tokens of a file of many gigabytes out of memory, the buffer is
+// lexed one window at a time; each call to next gives the tokens of the next
+// window.  Only the last window ends with an end_of_file.
+class ParallelLexer {
+    StringRef source;
+    unsigned jobs;
+    std::size_t window_size;
+    // Everything before this offset has been lexed.
+    std::size_t done = 0;
+    bool finished = false;
+    // One for each chunk of the current window, kept to reuse their memory.
+    std::vector<TokenArray> chunks;
+
+public:
+    // The default window of 64 MiB per thread gives every thread several
+    // chunks of a few MiB each, which keeps them equally busy.
+    ParallelLexer(StringRef source, unsigned jobs, std::size_t window_size = 0);
+    ParallelLexer(ParallelLexer const&) = delete;
+
+    // Replaces the contents of tokens with those of the next window.  Returns
+    // false once the whole buffer has been lexed.  If lexing stops at a
+    // character that cannot start a token, as tokenize_all would, that window
+    // is the last.
+    bool next(TokenArray& tokens);
+
+    // After next has stopped at an unrecognised character, carries on from
+    // the given offset, which must be past that character.
+    void resume(std::size_t offset);
+};
+
+// Lexes the whole buffer in one window.
+void tokenize_parallel(StringRef source, TokenArray& tokens, unsigned jobs);
+
+#endif
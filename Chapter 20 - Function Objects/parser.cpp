@@ -1,58 +1,681 @@
 #include "parser.hpp"
 #include "lexer.hpp"
+#include "buffer_lexer.hpp"
 #include "token.hpp"
 #include "expression.hpp"
 #include "number_expr.hpp"
 #include "variable_expr.hpp"
 #include "list_expr.hpp"
-#include <iostream>
+#include "let_expr.hpp"
+#include "line_index.hpp"
+#include "parallel_lexer.hpp"
+#include "interner.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <stdexcept>
-#include <cassert>
 
-std::shared_ptr<Expression> p_expression(Lexer& lexer);
+// Without an arena, nodes are allocated with std::make_shared as usual.  With
+// one, they are created in the arena and handed out through a shared_ptr that
+// has no control block, so copying it touches no reference count.
+template <typename T, typename... Args>
+std::shared_ptr<T> make_node(Arena* arena, Args&&... args) {
+    if (!arena)
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    return std::shared_ptr<T>(std::shared_ptr<T>{}, arena->create<T>(std::forward<Args>(args)...));
+}
 
-std::shared_ptr<Expression> parse_expression(std::istream& input) {
-    Lexer lexer(input);
+std::runtime_error parse_error(std::string const& what, Lexer::Position position) {
+    std::ostringstream os;
+    os << "Invalid input: " << what << " at " << position << '.';
+    return std::runtime_error{os.str()};
+}
+
+// The variables in scope at the current point of the input.  A let opens a
+// scope as soon as its list of variables has been read, so that the names
+// in its body can be resolved as they are read, and closes it again at its
+// closing parenthesis.  For every name we keep the scopes that bind it,
+// innermost last, so resolving a name takes no search.
+class Scopes {
+    struct Binding {
+        std::size_t scope;
+        int slot;
+    };
+
+    std::vector<ListExpr const*> lets;
+    std::vector<std::vector<SymbolId>> names;
+    std::unordered_map<SymbolId, std::vector<Binding>> bindings;
+
+public:
+    void open(ListExpr const* let, std::vector<SymbolId> variables) {
+        for (std::size_t i = 0; i < variables.size(); ++i)
+            bindings[variables[i]].push_back({lets.size(), static_cast<int>(i)});
+        lets.push_back(let);
+        names.push_back(std::move(variables));
+    }
+
+    void close() {
+        for (auto name : names.back())
+            bindings[name].pop_back();
+        lets.pop_back();
+        names.pop_back();
+    }
+
+    bool is_innermost(ListExpr const* let) const {
+        return !lets.empty() && lets.back() == let;
+    }
+
+    // Returns false if the name is not bound by any let.
+    bool resolve(SymbolId name, int& depth, int& slot) const {
+        auto it = bindings.find(name);
+        if (it == bindings.end() || it->second.empty())
+            return false;
+        depth = lets.size() - 1 - it->second.back().scope;
+        slot = it->second.back().slot;
+        return true;
+    }
+};
+
+bool is_let(ListExpr const& list) {
+    static SymbolId const let = intern(StringRef("let", 3));
+    if (list.size() == 0)
+        return false;
+    auto head = dynamic_cast<VariableExpr const*>(list.get_element(0).get());
+    return head && head->get_symbol() == let;
+}
+
+// Reads the names out of the list of variables of a let, which looks like
+// ((name value) ...) with no name twice.  Returns what is wrong with it if it
+// does not, or an empty string if it does.
+std::string let_variables(Expression const& expr, std::vector<SymbolId>& variables) {
+    auto list = dynamic_cast<ListExpr const*>(&expr);
+    if (!list)
+        return "expected a list of variables";
+    for (std::size_t i = 0; i < list->size(); ++i) {
+        auto binding = dynamic_cast<ListExpr const*>(list->get_element(i).get());
+        if (!binding || binding->size() != 2)
+            return "expected a list of variables";
+        auto name = dynamic_cast<VariableExpr const*>(binding->get_element(0).get());
+        if (!name)
+            return "expected a list of variables";
+        if (std::find(variables.begin(), variables.end(), name->get_symbol()) != variables.end())
+            return "duplicate variable " + name->get_name() + " in let";
+        variables.push_back(name->get_symbol());
+    }
+    return {};
+}
+
+// The position is only worked out if there is an error to report.
+template <typename LexerType>
+std::shared_ptr<Expression> make_let(ListExpr const& list, Arena* arena, LexerType const& lexer) {
+    if (list.size() != 3)
+        throw parse_error("expected a single expression as the body of let", lexer.get_position());
+    auto let = make_node<LetExpr>(arena, arena);
+    auto const& variables = static_cast<ListExpr const&>(*list.get_element(1));
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+        auto const& binding = static_cast<ListExpr const&>(*variables.get_element(i));
+        let->add_variable(static_cast<VariableExpr const&>(*binding.get_element(0)).get_symbol(),
+                          binding.get_element(1));
+    }
+    let->set_body(list.get_element(2));
+    return let;
+}
+
+// Hands out tokens that have already been lexed, with the same positions and
+// errors as a lexer would give.  Once at the end, it stays there.  Where a
+// token ends is only looked up when a position is asked for.
+class TokenCursor {
+    TokenArray const& tokens;
+    StringRef input;
+    std::size_t const end_of_file;
+    std::size_t next = 0;
+    // The index of the last token handed out, if any.
+    std::size_t current = -1;
+    mutable LineIndex lines;
+
+public:
+    TokenCursor(TokenArray const& tokens, StringRef input)
+        : tokens(tokens), input(input), end_of_file(tokens.size() - 1), lines(input.begin(), input.end()) {}
+
+    Token extract() {
+        current = next;
+        if (next != end_of_file)
+            return tokens.get(next++);
+        if (tokens.unrecognised)
+            throw std::runtime_error{"unrecognised character"};
+        return tokens.get(next);
+    }
+
+    StringRef get_digits(Token) const {
+        return StringRef(input.begin() + tokens.get_offset(current), tokens.get_length(current));
+    }
+
+    Lexer::Position get_position() const {
+        if (current == std::size_t(-1))
+            return lines.position(0);
+        return lines.position(tokens.get_offset(current) + tokens.get_length(current));
+    }
+
+    explicit operator bool() const {
+        return true;
+    }
+};
 
+// Hands out the tokens of a ParallelLexer in the same way, a window at a time.
+// It can also skip a line after an error, as the lexers can.
+class WindowCursor {
+    ParallelLexer& lexer;
+    StringRef input;
+    TokenArray tokens;
+    std::size_t next = 0;
+    // The index in tokens of the last token handed out, if any.
+    std::size_t current = -1;
+    // Where the last token of the previous window ended.
+    std::size_t previous_end = 0;
+    mutable LineIndex lines;
+
+    std::size_t end_offset() const {
+        if (current == std::size_t(-1))
+            return previous_end;
+        return tokens.get_offset(current) + tokens.get_length(current);
+    }
+
+    // Moves on to the next window if this one has been used up.  Returns
+    // false if there is none.  A window is lexed as a whole, so this is where
+    // lexing is timed.
+    bool fill() {
+        while (next == tokens.size()) {
+            previous_end = end_offset();
+            current = -1;
+            next = 0;
+            ProfiledPhase lexing(Phase::lex);
+            if (!lexer.next(tokens)) {
+                tokens.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    WindowCursor(ParallelLexer& lexer, StringRef input)
+        : lexer(lexer), input(input), lines(input.begin(), input.end()) {}
+
+    Token extract() {
+        if (!fill())
+            return {TokenType::end_of_file, 0};
+        current = next;
+        Token const token = tokens.get(next);
+        if (token.type != TokenType::end_of_file) {
+            ++next;
+            return token;
+        }
+        if (tokens.unrecognised)
+            throw std::runtime_error{"unrecognised character"};
+        return token;
+    }
+
+    StringRef get_digits(Token) const {
+        return StringRef(input.begin() + tokens.get_offset(current), tokens.get_length(current));
+    }
+
+    Lexer::Position get_position() const {
+        return lines.position(end_offset());
+    }
+
+    explicit operator bool() const {
+        return true;
+    }
+
+    void skip_line() {
+        std::size_t const from = end_offset();
+        auto newline = static_cast<char const*>(std::memchr(input.begin() + from, '\n', input.size() - from));
+        std::size_t const line_end = newline ? newline - input.begin() + 1 : input.size();
+
+        while (fill() && tokens.get(next).type != TokenType::end_of_file && tokens.get_offset(next) < line_end)
+            ++next;
+
+        // Lexing stopped at an unrecognised character on this line, so it
+        // has to start again after the line.
+        if (next < tokens.size() && tokens.get(next).type == TokenType::end_of_file && tokens.unrecognised &&
+            tokens.get_offset(next) < line_end) {
+            lexer.resume(line_end);
+            tokens.clear();
+            next = 0;
+            current = -1;
+            previous_end = line_end;
+        }
+    }
+};
+
+// The grammar is simple enough that we don't need recursion to parse it: the
+// only thing we have to remember is which lists have been opened but not yet
+// closed.  We keep those on a stack of our own, which can grow much larger
+// than the call stack, so arbitrarily deeply nested input can be parsed.
+//
+// The parser works the same way on top of a Lexer and a BufferLexer.  If
+// allow_end is set, reaching the end of the input before the expression has
+// begun returns nullptr instead of being an error.  If outer is given, the
+// expression is inside the lets whose scopes it holds.
+template <typename LexerType>
+std::shared_ptr<Expression> p_top_level(LexerType& lexer, Arena* arena, bool allow_end = false,
+                                        Scopes const* outer = nullptr) {
     if (!lexer)
         throw std::runtime_error{"Invalid input: stream not in good state."};
 
-    auto expr = p_expression(lexer);
-    if (!expr)
-        throw std::runtime_error{"Invalid input: no expression found."};
+    // The innermost open list is at the back.
+    std::vector<std::shared_ptr<ListExpr>> open_lists;
+    Scopes scopes = outer ? *outer : Scopes();
+
+    for (;;) {
+        auto const token = lexer.extract();
+        std::shared_ptr<Expression> expr;
+
+        switch (token.type) {
+        case TokenType::end_of_file:
+            if (allow_end && open_lists.empty())
+                return nullptr;
+            throw parse_error("expected an expression", lexer.get_position());
+        case TokenType::close_paren:
+            if (open_lists.empty())
+                throw parse_error("no expression found", lexer.get_position());
+            if (!is_let(*open_lists.back())) {
+                expr = std::move(open_lists.back());
+            }
+            else {
+                if (!scopes.is_innermost(open_lists.back().get()))
+                    throw parse_error("expected a list of variables", lexer.get_position());
+                expr = make_let(*open_lists.back(), arena, lexer);
+                scopes.close();
+            }
+            open_lists.pop_back();
+            break;
+        case TokenType::name: {
+            int depth, slot;
+            if (scopes.resolve(token.value, depth, slot))
+                expr = make_node<VariableExpr>(arena, token.value, depth, slot);
+            else
+                expr = make_node<VariableExpr>(arena, token.value);
+            break;
+        }
+        case TokenType::number:
+            expr = make_node<NumberExpr>(arena, token.value);
+            break;
+        case TokenType::big_number:
+            expr = make_node<NumberExpr>(arena, Integer::parse(lexer.get_digits(token)));
+            break;
+        case TokenType::open_paren:
+            open_lists.push_back(make_node<ListExpr>(arena, arena));
+            continue;
+        }
+
+        if (open_lists.empty())
+            return expr;
+
+        auto& parent = *open_lists.back();
+        parent.add(std::move(expr));
+        if (parent.size() == 2 && is_let(parent)) {
+            std::vector<SymbolId> variables;
+            auto const error = let_variables(*parent.get_element(1), variables);
+            if (!error.empty())
+                throw parse_error(error, lexer.get_position());
+            scopes.open(&parent, std::move(variables));
+        }
+    }
+}
+
+std::shared_ptr<Expression> parse_expression(std::istream& input) {
+    Lexer lexer(input);
+    return p_top_level(lexer, nullptr);
+}
+
+std::shared_ptr<Expression> parse_expression(std::istream& input, Arena& arena) {
+    Lexer lexer(input);
+    return p_top_level(lexer, &arena);
+}
+
+std::shared_ptr<Expression> parse_expression(StringRef input) {
+    BufferLexer lexer(input);
+    return p_top_level(lexer, nullptr);
+}
+
+std::shared_ptr<Expression> parse_expression(StringRef input, Arena& arena) {
+    BufferLexer lexer(input);
+    return p_top_level(lexer, &arena);
+}
 
-    return expr;
+std::shared_ptr<Expression> parse_expression(TokenArray const& tokens, StringRef input) {
+    TokenCursor cursor(tokens, input);
+    return p_top_level(cursor, nullptr);
 }
 
-std::shared_ptr<Expression> p_function_call(Lexer& lexer) {
-    assert(lexer);
+std::shared_ptr<Expression> parse_expression(TokenArray const& tokens, StringRef input, Arena& arena) {
+    TokenCursor cursor(tokens, input);
+    return p_top_level(cursor, &arena);
+}
+
+ExpressionReader::ExpressionReader(std::istream& input) : stream_lexer(new Lexer(input)) {}
+
+ExpressionReader::ExpressionReader(StringRef input) : buffer_lexer(new BufferLexer(input)) {}
+
+ExpressionReader::ExpressionReader(ParallelLexer& lexer, StringRef input)
+    : window_cursor(new WindowCursor(lexer, input)) {}
+
+ExpressionReader::~ExpressionReader() = default;
 
-    auto list = std::make_shared<ListExpr>();
+template <typename LexerType>
+std::shared_ptr<Expression> read_expression(LexerType& lexer, Arena* arena) {
+    try {
+        return p_top_level(lexer, arena, true);
+    }
+    catch (std::exception&) {
+        lexer.skip_line();
+        throw;
+    }
+}
+
+std::shared_ptr<Expression> ExpressionReader::read(Arena* arena) {
+    if (stream_lexer)
+        return read_expression(*stream_lexer, arena);
+    if (buffer_lexer)
+        return read_expression(*buffer_lexer, arena);
+    return read_expression(*window_cursor, arena);
+}
 
-    while (auto ptr = p_expression(lexer))
-        list->add(ptr);
+std::shared_ptr<Expression> ExpressionReader::next() {
+    return read(nullptr);
+}
 
-    return list;
+std::shared_ptr<Expression> ExpressionReader::next(Arena& arena) {
+    return read(&arena);
 }
 
-std::shared_ptr<Expression> p_expression(Lexer& lexer) {
-    assert(lexer);
+// A token or a list in the text of an IncrementalParser.  The root of the
+// tree is a list without parentheses: the whole text.  Nothing in a node
+// depends on where it is, so a node after an edit stays as it was.
+struct SyntaxNode {
+    std::size_t width = 0;
+    bool is_list = false;
+    // The elements of a list and where each one ends, counted from just
+    // inside the opening parenthesis.  Keeping the ends together means that
+    // the element at an offset is found by a binary search.
+    std::vector<std::unique_ptr<SyntaxNode>> children;
+    std::vector<std::size_t> ends;
 
-    auto token = lexer.extract();
+    ~SyntaxNode();
+};
 
-    if (token.type == end_of_file_token)
-        throw std::runtime_error{"Invalid input: expected an expression."};
+// Takes the tree apart a node at a time, so that destroying deeply nested
+// lists does not recurse without bound.
+SyntaxNode::~SyntaxNode() {
+    std::vector<std::unique_ptr<SyntaxNode>> pending = std::move(children);
+    while (!pending.empty()) {
+        std::unique_ptr<SyntaxNode> node = std::move(pending.back());
+        pending.pop_back();
+        for (auto& child : node->children)
+            pending.push_back(std::move(child));
+        node->children.clear();
+    }
+}
 
-    if (token.type == close_paren_token)
-        return {};
+// Parses region as any number of complete expressions, inside the lets whose
+// scopes are given, and adds them, their nodes and where the nodes end to
+// exprs, nodes and ends.
+void parse_region(StringRef region, Scopes const& scopes, TokenArray& tokens,
+                  std::vector<std::shared_ptr<Expression>>& exprs, std::vector<std::unique_ptr<SyntaxNode>>& nodes,
+                  std::vector<std::size_t>& ends) {
+    tokenize_all(region, tokens);
+    TokenCursor cursor(tokens, region);
+    while (auto expr = p_top_level(cursor, nullptr, true, &scopes))
+        exprs.push_back(std::move(expr));
 
-    if (token.type == name_token)
-        return std::make_shared<VariableExpr>(token.value);
-    if (token.type == number_token)
-        return std::make_shared<NumberExpr>(std::stoi(token.value));
-    if (token.type == open_paren_token)
-        return p_function_call(lexer);
+    // The parentheses are known to match now.  A list's end is only known
+    // when it is closed, which is before anything after it is added.
+    std::vector<SyntaxNode*> open_lists;
+    std::vector<std::size_t> list_starts;
+    std::size_t const end_of_file = tokens.size() - 1;
+    for (std::size_t i = 0; i != end_of_file; ++i) {
+        std::size_t const offset = tokens.get_offset(i);
+        std::size_t const end = offset + tokens.get_length(i);
+        TokenType const type = tokens.get(i).type;
+        if (type == TokenType::close_paren) {
+            open_lists.back()->width = end - list_starts.back();
+            open_lists.pop_back();
+            list_starts.pop_back();
+        }
+        else {
+            std::unique_ptr<SyntaxNode> node(new SyntaxNode);
+            node->width = end - offset;
+            node->is_list = type == TokenType::open_paren;
+            SyntaxNode* const added = node.get();
+            (open_lists.empty() ? nodes : open_lists.back()->children).push_back(std::move(node));
+            if (added->is_list) {
+                open_lists.push_back(added);
+                list_starts.push_back(offset);
+                continue;
+            }
+        }
+        if (open_lists.empty())
+            ends.push_back(end);
+        else
+            open_lists.back()->ends.push_back(end - list_starts.back() - 1);
+    }
+}
 
-    throw std::logic_error{"Unrecognised token type."};
+// A copy of a let with another body.
+std::shared_ptr<Expression> with_body(LetExpr const& let, std::shared_ptr<Expression> body) {
+    auto copy = std::make_shared<LetExpr>();
+    for (std::size_t i = 0; i < let.variable_count(); ++i)
+        copy->add_variable(let.get_name(i), let.get_child(i));
+    copy->set_body(std::move(body));
+    return copy;
 }
 
+// A copy of a list with the elements from first up to last replaced.
+std::shared_ptr<Expression> with_elements(ListExpr const& list, std::size_t first, std::size_t last,
+                                          std::vector<std::shared_ptr<Expression>> const& elements) {
+    auto copy = std::make_shared<ListExpr>();
+    copy->reserve(list.size() - (last - first) + elements.size());
+    for (std::size_t i = 0; i < first; ++i)
+        copy->add(list.get_element(i));
+    for (auto const& element : elements)
+        copy->add(element);
+    for (std::size_t i = last; i < list.size(); ++i)
+        copy->add(list.get_element(i));
+    return copy;
+}
+
+// Replaces the elements of a vector from first up to last with those of
+// replacement.  An edit usually replaces as many elements as it takes away,
+// and then nothing has to be moved.
+template <typename T>
+void splice(std::vector<T>& elements, std::size_t first, std::size_t last, std::vector<T>& replacement) {
+    if (last - first == replacement.size()) {
+        std::move(replacement.begin(), replacement.end(), elements.begin() + first);
+        return;
+    }
+    elements.erase(elements.begin() + first, elements.begin() + last);
+    elements.insert(elements.begin() + first, std::make_move_iterator(replacement.begin()),
+                    std::make_move_iterator(replacement.end()));
+}
+
+IncrementalParser::IncrementalParser(StringRef text) : text(text.begin(), text.end()) {
+    parse_all();
+}
+
+IncrementalParser::~IncrementalParser() = default;
+
+void IncrementalParser::parse_all() {
+    valid = false;
+    std::unique_ptr<SyntaxNode> node(new SyntaxNode);
+    std::vector<std::shared_ptr<Expression>> exprs;
+    node->is_list = true;
+    node->width = text.size();
+    parse_region(StringRef(text), Scopes(), tokens, exprs, node->children, node->ends);
+    root = std::move(node);
+    expressions = std::move(exprs);
+    valid = true;
+}
+
+// Parses the text again after [first, last) of the old text has been replaced
+// by inserted characters.  Returns false if it could not be done without
+// parsing the whole text.
+bool IncrementalParser::parse_edit(std::size_t first, std::size_t last, std::size_t inserted) {
+    // The lists that hold the edit, outermost first, with the offset of the
+    // first character inside each, its expression, the same again if it is a
+    // let, and the index of the element the edit is in.  The root has no
+    // expression of its own.
+    struct Level {
+        SyntaxNode* node;
+        std::size_t start;
+        std::shared_ptr<Expression> expr;
+        LetExpr const* let;
+        std::size_t index;
+    };
+    std::vector<Level> path;
+    SyntaxNode* node = root.get();
+    std::size_t start = 0;
+    std::shared_ptr<Expression> expr;
+    LetExpr const* let = nullptr;
+
+    // Go into the element the edit is in for as long as that is a list with
+    // the edit strictly inside its parentheses.  The names and values of a
+    // let are resolved differently from its body, so they are parsed as part
+    // of the whole let.
+    std::size_t first_index;
+    for (;;) {
+        auto const& ends = node->ends;
+        first_index = std::lower_bound(ends.begin(), ends.end(), first - start) - ends.begin();
+        if (first_index == ends.size())
+            break;
+        auto const& child = *node->children[first_index];
+        std::size_t const child_start = start + ends[first_index] - child.width;
+        if (!child.is_list || child_start >= first || last >= child_start + child.width || (let && first_index < 2))
+            break;
+        std::shared_ptr<Expression> child_expr = !expr ? expressions[first_index]
+                                               : let   ? let->get_child(let->variable_count())
+                                                       : static_cast<ListExpr const&>(*expr).get_element(first_index);
+        path.push_back({node, start, std::move(expr), let, first_index});
+        node = node->children[first_index].get();
+        start = child_start + 1;
+        expr = std::move(child_expr);
+        let = dynamic_cast<LetExpr const*>(expr.get());
+    }
+
+    // The elements the edit touches, even if only at their ends, since the
+    // edit may join something onto them.
+    std::size_t end_index = first_index;
+    while (end_index != node->ends.size() &&
+           start + node->ends[end_index] - node->children[end_index]->width <= last)
+        ++end_index;
+
+    // An edit to the head of a list can change what it calls, or make it a
+    // let or stop it being one, and an edit to the variables of a let changes
+    // how its body is resolved, so the list is parsed again as a whole.
+    while (!path.empty() && (first_index == 0 || (let && first_index < 2))) {
+        first_index = path.back().index;
+        end_index = first_index + 1;
+        node = path.back().node;
+        start = path.back().start;
+        expr = std::move(path.back().expr);
+        let = path.back().let;
+        path.pop_back();
+    }
+
+    // What is parsed again runs from the end of the element before those
+    // touched to the start of the one after them, so that the tokens on
+    // either side end where they did before.
+    std::size_t const content_width = node == root.get() ? node->width : node->width - 2;
+    std::size_t const region_first = start + (first_index != 0 ? node->ends[first_index - 1] : 0);
+    std::size_t const region_last =
+        start + (end_index != node->ends.size() ? node->ends[end_index] - node->children[end_index]->width
+                                                 : content_width);
+
+    Scopes scopes;
+    auto open_scope = [&scopes](LetExpr const* let) {
+        if (!let)
+            return;
+        std::vector<SymbolId> names;
+        for (std::size_t i = 0; i < let->variable_count(); ++i)
+            names.push_back(let->get_name(i));
+        scopes.open(nullptr, std::move(names));
+    };
+    for (auto const& level : path)
+        open_scope(level.let);
+    open_scope(let);
+
+    std::size_t const removed = last - first;
+    StringRef const region(text.data() + region_first, region_last - region_first + inserted - removed);
+    std::vector<std::shared_ptr<Expression>> exprs;
+    std::vector<std::unique_ptr<SyntaxNode>> nodes;
+    std::vector<std::size_t> ends;
+    try {
+        parse_region(region, scopes, tokens, exprs, nodes, ends);
+    }
+    catch (std::exception&) {
+        return false;
+    }
+    if (let && node->children.size() - (end_index - first_index) + nodes.size() != 3)
+        return false;
+
+    // Only the expressions of the lists around the edit are new.  An edit to
+    // nothing but whitespace changes none of them.
+    if (first_index != end_index || !exprs.empty()) {
+        std::shared_ptr<Expression> replacement;
+        if (!expr)
+            splice(expressions, first_index, end_index, exprs);
+        else if (let)
+            replacement = exprs.empty() ? expr : with_body(*let, exprs.front());
+        else
+            replacement = with_elements(static_cast<ListExpr const&>(*expr), first_index, end_index, exprs);
+        for (auto level = path.rbegin(); level != path.rend(); ++level) {
+            if (!level->expr)
+                expressions[level->index] = std::move(replacement);
+            else if (level->let)
+                replacement = with_body(*level->let, std::move(replacement));
+            else
+                replacement = with_elements(static_cast<ListExpr const&>(*level->expr), level->index,
+                                            level->index + 1, {std::move(replacement)});
+        }
+    }
+
+    // Everything from the edit on moves along by the same amount.
+    for (auto& end : ends)
+        end += region_first - start;
+    splice(node->children, first_index, end_index, nodes);
+    splice(node->ends, first_index, end_index, ends);
+    auto const shift = [inserted, removed](SyntaxNode& node, std::size_t from) {
+        node.width = node.width + inserted - removed;
+        for (std::size_t i = from; i != node.ends.size(); ++i)
+            node.ends[i] = node.ends[i] + inserted - removed;
+    };
+    shift(*node, first_index + ends.size());
+    for (auto const& level : path)
+        shift(*level.node, level.index);
+    return true;
+}
+
+void IncrementalParser::edit(std::size_t offset, std::size_t length, StringRef replacement) {
+    if (offset > text.size() || length > text.size() - offset)
+        throw std::runtime_error{"edit beyond the end of the text"};
+    text.replace(offset, length, replacement.data(), replacement.size());
+    if (!valid || !parse_edit(offset, offset + length, replacement.size()))
+        parse_all();
+}
+
+std::string const& IncrementalParser::get_text() const {
+    return text;
+}
+
+std::size_t IncrementalParser::size() const {
+    return expressions.size();
+}
+
+std::shared_ptr<Expression> const& IncrementalParser::get(std::size_t i) const {
+    return expressions[i];
+}
@@ -2,9 +2,108 @@
 #define CHAPTER_20_PARSER_HPP
 
 #include "expression.hpp"
+#include "arena.hpp"
+#include "string_ref.hpp"
+#include "token.hpp"
 #include <istream>
 #include <memory>
+#include <string>
+#include <vector>
 
 std::shared_ptr<Expression> parse_expression(std::istream& input);
 
+// Places every node of the expression in the arena.  The returned pointer does
+// not own anything: it stays valid until the arena is reset or destroyed.
+std::shared_ptr<Expression> parse_expression(std::istream& input, Arena& arena);
+
+// The same, but lexing straight from a buffer that is already in memory,
+// without going through a stream.
+std::shared_ptr<Expression> parse_expression(StringRef input);
+std::shared_ptr<Expression> parse_expression(StringRef input, Arena& arena);
+
+// The same, but taking the tokens from an array that tokenize_all has already
+// filled from input.  The input is only looked at to report positions.
+std::shared_ptr<Expression> parse_expression(TokenArray const& tokens, StringRef input);
+std::shared_ptr<Expression> parse_expression(TokenArray const& tokens, StringRef input, Arena& arena);
+
+struct Lexer;
+struct BufferLexer;
+class ParallelLexer;
+class WindowCursor;
+
+// Reads one top-level expression after another out of the same input, keeping
+// a single lexer for all of them.  Expressions need not be on lines of their
+// own: several can share a line, and one can span many.
+class ExpressionReader {
+    std::unique_ptr<Lexer> stream_lexer;
+    std::unique_ptr<BufferLexer> buffer_lexer;
+    std::unique_ptr<WindowCursor> window_cursor;
+
+    std::shared_ptr<Expression> read(Arena* arena);
+
+public:
+    explicit ExpressionReader(std::istream& input);
+    explicit ExpressionReader(StringRef input);
+    // Takes the tokens from a ParallelLexer that lexes input.
+    ExpressionReader(ParallelLexer& lexer, StringRef input);
+    ExpressionReader(ExpressionReader const&) = delete;
+    ~ExpressionReader();
+
+    // Returns nullptr once only whitespace is left.  If the next expression
+    // cannot be parsed, throws after skipping the rest of the line the error
+    // was found on, so that the following call starts afresh.
+    std::shared_ptr<Expression> next();
+    std::shared_ptr<Expression> next(Arena& arena);
+};
+
+struct SyntaxNode;
+
+// Keeps a text of top-level expressions, such as one that is being edited
+// interactively, along with the expressions parsed from it.  After an edit,
+// only the tokens the edit touched are lexed again, and only the lists around
+// them are rebuilt: every other node of the old expressions is shared with
+// the new ones.
+//
+// To find what an edit touched, the parser keeps the tokens and lists of the
+// text as a tree in which each list knows where its elements end relative to
+// itself, not where they are in the text, so that an edit only moves the
+// elements that come after it in the lists around it.  The edit is parsed
+// again within the innermost list that holds all of it, unless it changes
+// what that list calls or, for a let, which names it binds; then the whole
+// list is.  If what is parsed again no longer makes complete expressions, as
+// when an edit splits a list in two, the whole text is parsed again.
+//
+// Each list around the edit is copied, so an edit costs time in proportion to
+// the number of elements of the lists it is in, not to the length of the
+// text.
+class IncrementalParser {
+    std::string text;
+    std::unique_ptr<SyntaxNode> root;
+    std::vector<std::shared_ptr<Expression>> expressions;
+    // Reused for every edit.
+    TokenArray tokens;
+    // False after a text that could not be parsed.
+    bool valid = false;
+
+    void parse_all();
+    bool parse_edit(std::size_t first, std::size_t last, std::size_t inserted);
+
+public:
+    // Throws if the text cannot be parsed, as edit does.
+    explicit IncrementalParser(StringRef text);
+    IncrementalParser(IncrementalParser const&) = delete;
+    ~IncrementalParser();
+
+    // Replaces length characters at offset with replacement and parses the
+    // result.  If it cannot be parsed, throws with the error that parsing the
+    // whole text would give.  The edit is kept, and the text is parsed as a
+    // whole after each edit until it can be parsed again; until then, the
+    // expressions are those of the last text that could be.
+    void edit(std::size_t offset, std::size_t length, StringRef replacement);
+
+    std::string const& get_text() const;
+    std::size_t size() const;
+    std::shared_ptr<Expression> const& get(std::size_t i) const;
+};
+
 #endif
@@ -0,0 +1,196 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#ifndef CHAPTER_20_NO_PROFILING
+bool profiling_enabled = false;
+#endif
+
+void enable_profiling() {
+#ifdef CHAPTER_20_NO_PROFILING
+    throw std::runtime_error{"profiling was disabled when this program was built"};
+#else
+    profiling_enabled = true;
+#endif
+}
+
+char const* phase_name(Phase phase) {
+    switch (phase) {
+    case Phase::lex:
+        return "lex";
+    case Phase::parse:
+        return "parse";
+    case Phase::fold:
+        return "fold";
+    case Phase::compile:
+        return "compile";
+    case Phase::evaluate:
+        return "evaluate";
+    }
+    return "";
+}
+
+Profile& operator+=(Profile& lhs, Profile const& rhs) {
+    for (int i = 0; i < phase_count; ++i) {
+        lhs.phases[i].count += rhs.phases[i].count;
+        lhs.phases[i].nanoseconds += rhs.phases[i].nanoseconds;
+    }
+    if (lhs.operations.size() < rhs.operations.size())
+        lhs.operations.resize(rhs.operations.size());
+    for (std::size_t i = 0; i < rhs.operations.size(); ++i) {
+        lhs.operations[i].calls += rhs.operations[i].calls;
+        lhs.operations[i].arguments += rhs.operations[i].arguments;
+        lhs.operations[i].nanoseconds += rhs.operations[i].nanoseconds;
+    }
+    return lhs;
+}
+
+// The profiles of threads that have finished.
+struct FinishedProfiles {
+    std::mutex mutex;
+    Profile total;
+};
+
+FinishedProfiles& get_finished_profiles() {
+    static FinishedProfiles finished;
+    return finished;
+}
+
+// A thread's profile is added to the finished ones when the thread exits.
+struct ThreadProfile {
+    Profile profile;
+
+    // Makes sure the finished profiles outlive this one.
+    ThreadProfile() { get_finished_profiles(); }
+
+    ~ThreadProfile() {
+        auto& finished = get_finished_profiles();
+        std::lock_guard<std::mutex> lock(finished.mutex);
+        finished.total += profile;
+    }
+};
+
+Profile& get_thread_profile() {
+    thread_local ThreadProfile thread_profile;
+    return thread_profile.profile;
+}
+
+unsigned long long to_nanoseconds(std::chrono::steady_clock::duration time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+void record_phase(Phase phase, std::chrono::steady_clock::duration time) {
+    auto& entry = get_thread_profile().phases[static_cast<int>(phase)];
+    entry.count += 1;
+    entry.nanoseconds += to_nanoseconds(time);
+}
+
+void record_call(SymbolId name, std::size_t arg_count, std::chrono::steady_clock::duration time) {
+    auto& operations = get_thread_profile().operations;
+    if (operations.size() <= static_cast<std::size_t>(name))
+        operations.resize(name + 1);
+    auto& entry = operations[name];
+    entry.calls += 1;
+    entry.arguments += arg_count;
+    entry.nanoseconds += to_nanoseconds(time);
+}
+
+Profile collect_profile() {
+    auto& finished = get_finished_profiles();
+    std::lock_guard<std::mutex> lock(finished.mutex);
+    Profile profile = finished.total;
+    profile += get_thread_profile();
+    return profile;
+}
+
+// Lexing happens in the middle of parsing, so the time spent on it is taken
+// out of the time for the parse phase.
+PhaseProfile reported_phase(Profile const& profile, Phase phase) {
+    PhaseProfile result = profile.phases[static_cast<int>(phase)];
+    if (phase == Phase::parse)
+        result.nanoseconds -= std::min(result.nanoseconds, profile.phases[static_cast<int>(Phase::lex)].nanoseconds);
+    return result;
+}
+
+std::vector<SymbolId> operations_by_time(Profile const& profile) {
+    std::vector<SymbolId> names;
+    for (std::size_t i = 0; i < profile.operations.size(); ++i)
+        if (profile.operations[i].calls > 0)
+            names.push_back(i);
+    std::sort(names.begin(), names.end(), [&](SymbolId lhs, SymbolId rhs) {
+        return profile.operations[lhs].nanoseconds > profile.operations[rhs].nanoseconds;
+    });
+    return names;
+}
+
+double to_milliseconds(unsigned long long nanoseconds) {
+    return nanoseconds / 1e6;
+}
+
+void write_profile_report(std::ostream& os, Profile const& profile) {
+    auto const flags = os.flags();
+    auto const precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+
+    os << "Phase          count    total ms\n";
+    for (int i = 0; i < phase_count; ++i) {
+        auto const phase = static_cast<Phase>(i);
+        auto const entry = reported_phase(profile, phase);
+        os << std::left << std::setw(10) << phase_name(phase) << std::right << std::setw(10) << entry.count
+           << std::setw(12) << to_milliseconds(entry.nanoseconds) << '\n';
+    }
+
+    os << "Operation      calls   arguments    total ms  ns per call\n";
+    for (auto name : operations_by_time(profile)) {
+        auto const& entry = profile.operations[name];
+        os << std::left << std::setw(10) << symbol_name(name) << std::right << std::setw(10) << entry.calls
+           << std::setw(12) << entry.arguments << std::setw(12) << to_milliseconds(entry.nanoseconds)
+           << std::setw(13) << double(entry.nanoseconds) / entry.calls << '\n';
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+// Names given to define can contain any character, so they are escaped as
+// JSON requires.
+void write_json_string(std::ostream& os, std::string const& s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+            os << escaped;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+void write_profile_json(std::ostream& os, Profile const& profile) {
+    os << "{\n  \"phases\": {";
+    for (int i = 0; i < phase_count; ++i) {
+        auto const phase = static_cast<Phase>(i);
+        auto const entry = reported_phase(profile, phase);
+        os << (i == 0 ? "\n" : ",\n") << "    \"" << phase_name(phase) << "\": {\"count\": " << entry.count
+           << ", \"nanoseconds\": " << entry.nanoseconds << '}';
+    }
+    os << "\n  },\n  \"operations\": [";
+    bool first = true;
+    for (auto name : operations_by_time(profile)) {
+        auto const& entry = profile.operations[name];
+        os << (first ? "\n" : ",\n") << "    {\"name\": ";
+        write_json_string(os, symbol_name(name));
+        os << ", \"calls\": " << entry.calls << ", \"arguments\": " << entry.arguments
+           << ", \"nanoseconds\": " << entry.nanoseconds << '}';
+        first = false;
+    }
+    os << "\n  ]\n}\n";
+}
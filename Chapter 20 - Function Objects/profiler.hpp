@@ -0,0 +1,124 @@
+#ifndef CHAPTER_20_PROFILER_HPP
+#define CHAPTER_20_PROFILER_HPP
+
+#include "interner.hpp"
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Counts how often each operation is called, with how many arguments, and
+// how long it takes, and how long each phase of handling a line takes.
+//
+// Profiling is off unless enable_profiling is called, and while it is off
+// the instrumentation costs a single well-predicted branch.  Building with
+// CHAPTER_20_NO_PROFILING removes even that.
+//
+// Each thread records into a profile of its own, so recording takes no locks.
+
+enum class Phase {
+    lex,
+    parse,
+    fold,
+    compile,
+    evaluate
+};
+
+int const phase_count = 5;
+
+char const* phase_name(Phase phase);
+
+struct PhaseProfile {
+    unsigned long long count = 0;
+    unsigned long long nanoseconds = 0;
+};
+
+struct OperationProfile {
+    unsigned long long calls = 0;
+    unsigned long long arguments = 0;
+    unsigned long long nanoseconds = 0;
+};
+
+struct Profile {
+    PhaseProfile phases[phase_count];
+    // Indexed by the SymbolId of the operation's name.
+    std::vector<OperationProfile> operations;
+};
+
+Profile& operator+=(Profile& lhs, Profile const& rhs);
+
+#ifdef CHAPTER_20_NO_PROFILING
+inline bool profiling() { return false; }
+#else
+// Only written by enable_profiling, which must be called before any other
+// threads are started.
+extern bool profiling_enabled;
+
+inline bool profiling() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_expect(profiling_enabled, false);
+#else
+    return profiling_enabled;
+#endif
+}
+#endif
+
+// Throws if profiling was compiled out.
+void enable_profiling();
+
+void record_phase(Phase phase, std::chrono::steady_clock::duration time);
+void record_call(SymbolId name, std::size_t arg_count, std::chrono::steady_clock::duration time);
+
+// The profiles of all threads so far, added up.  Threads that are still
+// running, other than the calling one, are not included.
+Profile collect_profile();
+
+// The phases are listed in order.  The parse phase does not include the time
+// spent lexing, which is listed separately.  Lexing is only timed where a
+// whole line or window of input is lexed at once: a single lexer that reads a
+// stream hands out its tokens one at a time as the parser asks for them, and
+// timing each of those would mostly measure the clock, so that lexing is part
+// of the parse phase.  Operations are sorted by time.
+void write_profile_report(std::ostream& os, Profile const& profile);
+void write_profile_json(std::ostream& os, Profile const& profile);
+
+// Times its own lifetime as the given phase, if profiling is on.
+class ProfiledPhase {
+    Phase phase;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ProfiledPhase(Phase phase) : phase(phase), active(profiling()) {
+        if (active)
+            start = std::chrono::steady_clock::now();
+    }
+    ProfiledPhase(ProfiledPhase const&) = delete;
+    ~ProfiledPhase() {
+        if (active)
+            record_phase(phase, std::chrono::steady_clock::now() - start);
+    }
+};
+
+// Times its own lifetime as a call to the named operation, if profiling is
+// on.  Only the call itself should be timed, not the evaluation of its
+// arguments, so that the time is that of the operation alone.
+class ProfiledCall {
+    SymbolId name;
+    std::size_t arg_count;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ProfiledCall(SymbolId name, std::size_t arg_count) : name(name), arg_count(arg_count), active(profiling()) {
+        if (active)
+            start = std::chrono::steady_clock::now();
+    }
+    ProfiledCall(ProfiledCall const&) = delete;
+    ~ProfiledCall() {
+        if (active)
+            record_call(name, arg_count, std::chrono::steady_clock::now() - start);
+    }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "result_cache.hpp"
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+// A rough estimate of what the list node, the hash table node, and the
+// allocation headers cost on top of the strings themselves.
+std::size_t const bytes_per_entry = 128;
+
+// Enough slots for every entry that fits in the cache, but no more than 8 MiB
+// worth of them however large the limit is.
+std::size_t const max_seen_hashes = 1 << 20;
+
+std::size_t seen_hash_slots(std::size_t max_bytes) {
+    std::size_t slots = 1;
+    while (slots < max_seen_hashes && slots < max_bytes / bytes_per_entry)
+        slots *= 2;
+    return slots;
+}
+
+std::string canonical_form(Expression const& expr) {
+    std::ostringstream os;
+    expr.print(os);
+    return os.str();
+}
+
+ResultCache::ResultCache(std::size_t max_bytes)
+    : seen_hashes(seen_hash_slots(max_bytes)), max_bytes(max_bytes) {}
+
+void ResultCache::check_generation(unsigned long long symbol_table_generation) {
+    if (generation != symbol_table_generation) {
+        clear();
+        generation = symbol_table_generation;
+    }
+}
+
+LineResult const* ResultCache::find_line(StringRef line) {
+    auto it = by_line.find(line);
+    if (it == by_line.end())
+        return nullptr;
+    statistics.line_hits += 1;
+    touch(it->second);
+    return &it->second->result;
+}
+
+LineResult const* ResultCache::find_structure(std::size_t hash, Expression const& expr) {
+    auto range = by_structure.equal_range(hash);
+    if (range.first == range.second)
+        return nullptr;
+
+    auto const canonical = canonical_form(expr);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->key == canonical) {
+            statistics.structure_hits += 1;
+            touch(it->second);
+            return &it->second->result;
+        }
+    }
+    return nullptr;
+}
+
+void ResultCache::record_miss() {
+    statistics.misses += 1;
+}
+
+bool ResultCache::note_seen(std::size_t hash) {
+    auto& slot = seen_hashes[hash & (seen_hashes.size() - 1)];
+    bool const seen = slot == hash;
+    slot = hash;
+    return seen;
+}
+
+void ResultCache::insert_line(StringRef line, LineResult const& result) {
+    if (note_seen(StringRefHash{}(line)))
+        insert({std::string(line), 0, false, result, 0});
+}
+
+void ResultCache::insert_structure(std::size_t hash, std::string const& canonical, LineResult const& result) {
+    insert({canonical, hash, true, result, 0});
+}
+
+void ResultCache::insert(Entry entry) {
+    entry.bytes = entry.key.size() + entry.result.text.size() + bytes_per_entry;
+    if (entry.bytes > max_bytes)
+        return;
+
+    entries.push_front(std::move(entry));
+    auto it = entries.begin();
+    if (it->structural) {
+        by_structure.emplace(it->hash, it);
+    } else if (!by_line.emplace(StringRef(it->key), it).second) {
+        // The line was there already.
+        entries.pop_front();
+        return;
+    }
+    bytes += it->bytes;
+
+    while (bytes > max_bytes)
+        evict();
+}
+
+void ResultCache::evict() {
+    auto it = std::prev(entries.end());
+    if (it->structural) {
+        auto range = by_structure.equal_range(it->hash);
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second == it) {
+                by_structure.erase(i);
+                break;
+            }
+        }
+    } else {
+        by_line.erase(StringRef(it->key));
+    }
+    bytes -= it->bytes;
+    entries.erase(it);
+    statistics.evictions += 1;
+}
+
+void ResultCache::touch(EntryList::iterator it) {
+    entries.splice(entries.begin(), entries, it);
+}
+
+void ResultCache::clear() {
+    entries.clear();
+    by_line.clear();
+    by_structure.clear();
+    std::fill(seen_hashes.begin(), seen_hashes.end(), 0);
+    bytes = 0;
+}
+
+CacheStatistics const& ResultCache::get_statistics() const {
+    return statistics;
+}
@@ -0,0 +1,93 @@
+#ifndef CHAPTER_20_RESULT_CACHE_HPP
+#define CHAPTER_20_RESULT_CACHE_HPP
+
+#include "expression.hpp"
+#include "string_ref.hpp"
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct LineResult {
+    bool ok;
+    // The value if ok, otherwise the error message.
+    std::string text;
+};
+
+struct CacheStatistics {
+    std::size_t line_hits = 0;
+    std::size_t structure_hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+};
+
+// Remembers the results of lines that were evaluated before.  Results can be
+// found again either by the exact text of the line, which skips parsing too,
+// or by the structure of the parsed expression, which catches lines that only
+// differ in their whitespace.
+//
+// Most lines are never repeated, and storing them would only cost time, so a
+// line is only stored once it has been seen before.  The same goes for an
+// expression's structure, whose canonical form is only printed once another
+// expression with the same hash has been seen.  A line that is never repeated
+// then costs no more than two hashes.
+//
+// Entries are evicted least recently used first once the memory they take up
+// goes over the limit.  All results belong to a single symbol table state:
+// when the generation of the table changes, the cache is emptied.
+class ResultCache {
+    struct Entry {
+        std::string key;
+        std::size_t hash;
+        bool structural;
+        LineResult result;
+        std::size_t bytes;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    EntryList entries;
+    // The keys refer to the text in the entries, which never moves, so that
+    // looking a line up does not copy it.
+    std::unordered_map<StringRef, EntryList::iterator, StringRefHash> by_line;
+    std::unordered_multimap<std::size_t, EntryList::iterator> by_structure;
+    // The hashes of lines and expressions seen recently.  A hash goes in the
+    // slot its low bits select and pushes out whatever was there.
+    std::vector<std::size_t> seen_hashes;
+    std::size_t max_bytes;
+    std::size_t bytes = 0;
+    unsigned long long generation = 0;
+    CacheStatistics statistics;
+
+    void insert(Entry entry);
+    void evict();
+    void touch(EntryList::iterator it);
+
+public:
+    explicit ResultCache(std::size_t max_bytes);
+    ResultCache(ResultCache const&) = delete;
+
+    void check_generation(unsigned long long symbol_table_generation);
+
+    LineResult const* find_line(StringRef line);
+    // The canonical form is only printed when some entry has the same hash.
+    LineResult const* find_structure(std::size_t hash, Expression const& expr);
+    // Counts a miss; called when neither lookup found anything.
+    void record_miss();
+    // Remembers that a line or expression with the given hash was seen, and
+    // returns whether one had been seen recently already, in which case its
+    // result is worth storing.  insert_line checks this itself.
+    bool note_seen(std::size_t hash);
+
+    void insert_line(StringRef line, LineResult const& result);
+    void insert_structure(std::size_t hash, std::string const& canonical, LineResult const& result);
+
+    void clear();
+
+    CacheStatistics const& get_statistics() const;
+};
+
+std::string canonical_form(Expression const& expr);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef CHAPTER_20_STRING_REF_HPP
+#define CHAPTER_20_STRING_REF_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// A read-only view of characters that are stored somewhere else, much like
+// C++17's std::string_view.  Copying one never allocates, but the characters
+// must outlive every StringRef that refers to them.
+class StringRef {
+    char const* first;
+    std::size_t length;
+
+public:
+    StringRef() : first(nullptr), length(0) {}
+    StringRef(char const* first, std::size_t length) : first(first), length(length) {}
+    StringRef(char const* first, char const* last) : first(first), length(last - first) {}
+    StringRef(std::string const& s) : first(s.data()), length(s.size()) {}
+
+    char const* data() const { return first; }
+    char const* begin() const { return first; }
+    char const* end() const { return first + length; }
+
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    char operator[](std::size_t i) const { return first[i]; }
+
+    explicit operator std::string() const { return std::string(first, length); }
+};
+
+inline bool operator==(StringRef lhs, StringRef rhs) {
+    return lhs.size() == rhs.size() && (lhs.empty() || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
+inline bool operator!=(StringRef lhs, StringRef rhs) {
+    return !(lhs == rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, StringRef s) {
+    return os.write(s.data(), s.size());
+}
+
+// FNV-1a; good enough for the short names we deal with.
+struct StringRefHash {
+    std::size_t operator()(StringRef s) const {
+        std::size_t hash = 14695981039346656037ull;
+        for (char c : s) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+};
+
+#endif
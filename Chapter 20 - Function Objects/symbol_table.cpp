@@ -1,11 +1,245 @@
 #include "symbol_table.hpp"
 #include "builtin_operations.hpp"
+#include "string_ref.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
+static unsigned long long next_generation() {
+    static std::atomic<unsigned long long> counter{0};
+    return ++counter;
+}
+
+// The builtins, and the perfect hash that finds them.  Builtin names are
+// told apart by their first and last characters and their length; the hash
+// packs those into one word, multiplies it by a seed and keeps the top bits.
+// The seed is found at compile time by trying one after the other until no
+// two builtins share a slot, so adding a builtin here is all that is needed.
+struct Builtin {
+    char const* name;
+    std::size_t length;
+    Integer (*function)(Arguments);
+    bool pure;
+    BuiltinKind kind;
+};
+
+// The last entry is a sentinel that no name can match.
+constexpr Builtin builtins[] = {
+    {"+", 1, builtin_add, true, BuiltinKind::add},
+    {"-", 1, builtin_subtract, true, BuiltinKind::subtract},
+    {"*", 1, builtin_multiply, true, BuiltinKind::multiply},
+    {"/", 1, builtin_divide, true, BuiltinKind::divide},
+    {"", std::size_t(-1), nullptr, false, BuiltinKind::none},
+};
+
+constexpr std::size_t builtin_count = sizeof(builtins) / sizeof(builtins[0]) - 1;
+
+// Twice as many slots as builtins, rounded up to a power of two.
+constexpr unsigned slot_bits_for(std::size_t count, unsigned bits = 0) {
+    return (std::size_t(1) << bits) >= 2 * count ? bits : slot_bits_for(count, bits + 1);
+}
+
+constexpr unsigned builtin_slot_bits = slot_bits_for(builtin_count);
+constexpr std::size_t builtin_slot_count = std::size_t(1) << builtin_slot_bits;
+
+constexpr std::uint64_t builtin_key(char const* name, std::size_t length) {
+    return std::uint64_t(static_cast<unsigned char>(name[0]))
+         | std::uint64_t(static_cast<unsigned char>(name[length ? length - 1 : 0])) << 8
+         | std::uint64_t(length) << 16;
+}
+
+constexpr std::size_t builtin_slot(std::uint64_t key, std::uint64_t seed) {
+    return (key * seed) >> (64 - builtin_slot_bits);
+}
+
+constexpr std::size_t slot_of_builtin(std::size_t i, std::uint64_t seed) {
+    return builtin_slot(builtin_key(builtins[i].name, builtins[i].length), seed);
+}
+
+constexpr bool is_perfect(std::uint64_t seed, std::size_t i = 0, std::size_t j = 1) {
+    return i == builtin_count ? true
+         : j >= builtin_count ? is_perfect(seed, i + 1, i + 2)
+         : slot_of_builtin(i, seed) != slot_of_builtin(j, seed) && is_perfect(seed, i, j + 1);
+}
+
+constexpr std::uint64_t find_seed(std::uint64_t seed) {
+    return is_perfect(seed) ? seed : find_seed(seed + 2);
+}
+
+constexpr std::uint64_t builtin_seed = find_seed(0x9e3779b97f4a7c15ull);
+
+// Which builtin is in each slot.  Empty slots refer to the sentinel, so a
+// lookup always makes the same single comparison.
+constexpr std::size_t builtin_in_slot(std::size_t slot, std::size_t i = 0) {
+    return i == builtin_count || slot_of_builtin(i, builtin_seed) == slot ? i : builtin_in_slot(slot, i + 1);
+}
+
+template <std::size_t... I>
+struct Indices {};
+
+template <std::size_t N, std::size_t... I>
+struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+template <std::size_t... I>
+struct MakeIndices<0, I...> {
+    using type = Indices<I...>;
+};
+
+struct SlotTable {
+    unsigned char builtin[builtin_slot_count];
+};
+
+template <std::size_t... I>
+constexpr SlotTable make_slot_table(Indices<I...>) {
+    return {{static_cast<unsigned char>(builtin_in_slot(I))...}};
+}
+
+constexpr SlotTable builtin_slots = make_slot_table(MakeIndices<builtin_slot_count>::type{});
+
+static_assert(builtin_count < 255, "builtin indices must fit in the slot table");
+
+// std::function is not a literal type, so the operations themselves cannot be
+// built at compile time.  They hold nothing but a function pointer, though,
+// so building them never allocates.
+template <typename Indices>
+struct BuiltinSymbols;
+
+template <std::size_t... I>
+struct BuiltinSymbols<Indices<I...>> {
+    static SymbolTable::Symbol const symbols[];
+};
+
+template <std::size_t... I>
+SymbolTable::Symbol const BuiltinSymbols<Indices<I...>>::symbols[] = {
+    {builtins[I].function, builtins[I].pure, builtins[I].kind}...
+};
+
+using AllBuiltinSymbols = BuiltinSymbols<MakeIndices<builtin_count + 1>::type>;
+
+SymbolTable::Symbol const* find_builtin(std::string const& name) {
+    std::size_t const i = builtin_slots.builtin[builtin_slot(builtin_key(name.data(), name.size()), builtin_seed)];
+    bool const match = builtins[i].length == name.size() && std::memcmp(builtins[i].name, name.data(), name.size()) == 0;
+    return match ? &AllBuiltinSymbols::symbols[i] : nullptr;
+}
+
+SymbolTable::SymbolTable() : SymbolTable(false) {}
+
+SymbolTable::SymbolTable(bool has_builtins)
+    : has_builtins(has_builtins), used_count(0), generation(next_generation()) {}
+
+SymbolTable::SymbolTable(SymbolTable const& other)
+    : has_builtins(other.has_builtins), entries(other.entries), used_count(other.used_count),
+      generation(next_generation()) {}
+
+// A move keeps the entries where they are, so lookups cached against the
+// source are still good against the destination; the source is left empty and
+// restamped.
+SymbolTable::SymbolTable(SymbolTable&& other)
+    : has_builtins(other.has_builtins), entries(std::move(other.entries)), used_count(other.used_count),
+      generation(other.generation) {
+    other.has_builtins = false;
+    other.entries.clear();
+    other.used_count = 0;
+    other.generation = next_generation();
+}
+
+SymbolTable& SymbolTable::operator=(SymbolTable const& other) {
+    has_builtins = other.has_builtins;
+    entries = other.entries;
+    used_count = other.used_count;
+    generation = next_generation();
+    return *this;
+}
+
+SymbolTable& SymbolTable::operator=(SymbolTable&& other) {
+    if (this == &other)
+        return *this;
+    has_builtins = other.has_builtins;
+    entries = std::move(other.entries);
+    used_count = other.used_count;
+    generation = other.generation;
+    other.has_builtins = false;
+    other.entries.clear();
+    other.used_count = 0;
+    other.generation = next_generation();
+    return *this;
+}
+
+std::size_t SymbolTable::find_slot(std::string const& name, std::size_t hash) const {
+    std::size_t const mask = entries.size() - 1;
+    std::size_t i = hash & mask;
+    while (entries[i].used && (entries[i].hash != hash || entries[i].name != name))
+        i = (i + 1) & mask;
+    return i;
+}
+
+SymbolTable::Symbol const* SymbolTable::find_symbol(std::string const& name) const {
+    if (used_count != 0) {
+        Entry const& entry = entries[find_slot(name, StringRefHash{}(name))];
+        if (entry.used)
+            return entry.defined ? &entry.symbol : nullptr;
+    }
+    return has_builtins ? find_builtin(name) : nullptr;
+}
+
+void SymbolTable::grow() {
+    std::vector<Entry> old(entries.empty() ? 8 : entries.size() * 2);
+    old.swap(entries);
+    for (auto& entry : old)
+        if (entry.used)
+            entries[find_slot(entry.name, entry.hash)] = std::move(entry);
+}
+
+SymbolTable::Entry& SymbolTable::entry_for(std::string const& name) {
+    if ((used_count + 1) * 4 > entries.size() * 3)
+        grow();
+    std::size_t const hash = StringRefHash{}(name);
+    Entry& entry = entries[find_slot(name, hash)];
+    if (!entry.used) {
+        entry.name = name;
+        entry.hash = hash;
+        entry.used = true;
+        ++used_count;
+    }
+    return entry;
+}
+
+// The message is the one std::map::at gives, which is what this table used
+// to be; it ends up in the interpreter's output.
+Operation const& SymbolTable::at(std::string const& name) const {
+    if (Symbol const* symbol = find_symbol(name))
+        return symbol->operation;
+    throw std::out_of_range{"map::at"};
+}
+
+bool SymbolTable::is_pure(std::string const& name) const {
+    Symbol const* symbol = find_symbol(name);
+    return symbol && symbol->pure;
+}
+
+void SymbolTable::define(std::string const& name, Operation operation, bool pure) {
+    Entry& entry = entry_for(name);
+    entry.symbol = {std::move(operation), pure, BuiltinKind::none};
+    entry.defined = true;
+    generation = next_generation();
+}
+
+// Only names that are defined somewhere need an entry to hide them.
+void SymbolTable::remove(std::string const& name) {
+    if (find_symbol(name)) {
+        Entry& entry = entry_for(name);
+        entry.symbol = {};
+        entry.defined = false;
+    }
+    generation = next_generation();
+}
+
+unsigned long long SymbolTable::get_generation() const {
+    return generation;
+}
+
+// Nothing to build: the builtins are already there.
 SymbolTable get_default_symbol_table() {
-    return {
-        {"+", builtin_add},
-        {"-", builtin_subtract},
-        {"*", builtin_multiply},
-        {"/", builtin_divide}
-    };
+    return SymbolTable(true);
 }
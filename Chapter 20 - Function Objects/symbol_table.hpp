@@ -1,13 +1,92 @@
 #ifndef CHAPTER_20_SYMBOL_TABLE_HPP
 #define CHAPTER_20_SYMBOL_TABLE_HPP
 
+#include "arguments.hpp"
+#include "builtin_operations.hpp"
+#include "integer.hpp"
+#include <cstddef>
 #include <functional>
-#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
-using Operation = std::function<int(std::vector<int> const&)>;
-using SymbolTable = std::map<std::string, Operation>;
+using Operation = std::function<Integer(Arguments)>;
+
+// Every table is stamped with a generation number that no other table, and no
+// earlier state of the same table, has ever had.  Code that caches the result
+// of a lookup can remember the generation it looked in, and knows that the
+// cached result is still good for as long as the generation does not change.
+//
+// An operation can be marked pure, meaning that its result depends on nothing
+// but its arguments.  Calls to pure operations with constant arguments may be
+// evaluated ahead of time.
+//
+// The builtin operations live in a single constant table, shared by every
+// table that has them, which is indexed by a perfect hash worked out at
+// compile time.  Anything defined or removed later goes into a flat hash table
+// of the table's own, which is looked in first.
+class SymbolTable {
+public:
+    // For the builtins, builtin says which one the operation is; for
+    // anything else it is BuiltinKind::none.
+    struct Symbol {
+        Operation operation;
+        bool pure;
+        BuiltinKind builtin;
+    };
+
+private:
+    // Open addressing with linear probing.  A removed name keeps its entry,
+    // marked as not defined, so that it still hides a builtin of the same
+    // name; entries are therefore never freed until the table is.
+    struct Entry {
+        std::string name;
+        std::size_t hash = 0;
+        Symbol symbol;
+        bool used = false;
+        bool defined = false;
+    };
+
+    bool has_builtins;
+    // The size is zero or a power of two, and at most three quarters of the
+    // entries are used, so every probe sequence ends at an unused entry.
+    std::vector<Entry> entries;
+    std::size_t used_count;
+    unsigned long long generation;
+
+    // The index of the entry for name, or of the unused entry where it would
+    // go.  There must be at least one entry.
+    std::size_t find_slot(std::string const& name, std::size_t hash) const;
+    // Finds the entry for name, adding it if there is none.
+    Entry& entry_for(std::string const& name);
+    void grow();
+
+    explicit SymbolTable(bool has_builtins);
+
+    friend SymbolTable get_default_symbol_table();
+
+public:
+    SymbolTable();
+    SymbolTable(SymbolTable const& other);
+    SymbolTable(SymbolTable&& other);
+    SymbolTable& operator=(SymbolTable const& other);
+    SymbolTable& operator=(SymbolTable&& other);
+
+    Operation const& at(std::string const& name) const;
+    Symbol const* find_symbol(std::string const& name) const;
+
+    bool is_pure(std::string const& name) const;
+
+    // Both give the table a new generation, so that anything bound against
+    // it looks its names up again.
+    void define(std::string const& name, Operation operation, bool pure = false);
+    void remove(std::string const& name);
+
+    unsigned long long get_generation() const;
+};
+
+// Looks name up among the builtins only, returning null if it is not one.
+SymbolTable::Symbol const* find_builtin(std::string const& name);
 
 SymbolTable get_default_symbol_table();
 
@@ -1,27 +1,69 @@
 #include "token.hpp"
+#include <algorithm>
+#include <utility>
 
-bool operator==(Token const& lhs, Token const& rhs) {
-    return lhs.type == rhs.type && lhs.value == rhs.value;
+void TokenArray::grow() {
+    reserve(capacity == 0 ? 64 : 2 * capacity);
 }
 
-bool operator!=(Token const& lhs, Token const& rhs) {
-    return !(lhs == rhs);
+void TokenArray::reserve(std::size_t new_capacity) {
+    std::unique_ptr<TokenType[]> new_types(new TokenType[new_capacity]);
+    std::unique_ptr<std::int64_t[]> new_values(new std::int64_t[new_capacity]);
+    std::unique_ptr<std::size_t[]> new_offsets(new std::size_t[new_capacity]);
+    std::unique_ptr<std::uint32_t[]> new_lengths(new std::uint32_t[new_capacity]);
+    std::copy(types.get(), types.get() + count, new_types.get());
+    std::copy(values.get(), values.get() + count, new_values.get());
+    std::copy(offsets.get(), offsets.get() + count, new_offsets.get());
+    std::copy(lengths.get(), lengths.get() + count, new_lengths.get());
+    types = std::move(new_types);
+    values = std::move(new_values);
+    offsets = std::move(new_offsets);
+    lengths = std::move(new_lengths);
+    capacity = new_capacity;
+}
+
+void TokenArray::resize(std::size_t size) {
+    if (size > capacity)
+        reserve(std::max(size, 2 * capacity));
+    count = size;
+}
+
+void TokenArray::copy(std::size_t at, TokenArray const& other, std::size_t first, std::size_t last,
+                      std::size_t offset) {
+    std::copy(other.types.get() + first, other.types.get() + last, types.get() + at);
+    std::copy(other.values.get() + first, other.values.get() + last, values.get() + at);
+    std::copy(other.lengths.get() + first, other.lengths.get() + last, lengths.get() + at);
+    for (std::size_t i = first; i != last; ++i, ++at) {
+        offsets[at] = other.offsets[i] + offset;
+        if (types[at] == TokenType::big_number)
+            values[at] += offset;
+    }
 }
 
 std::ostream& operator<<(std::ostream& os, Token const& tok) {
     os << "{ ";
 
-    if (tok.type == open_paren_token)
-        os << "open_paren_token";
-    else if (tok.type == close_paren_token)
-        os << "close_paren_token";
-    else if (tok.type == name_token)
-        os << "name_token";
-    else if (tok.type == number_token)
-        os << "number_token";
-    else if (tok.type == end_of_file_token)
-        os << "end_of_file_token";
+    switch (tok.type) {
+    case TokenType::open_paren:
+        os << "open_paren_token, \"(\"";
+        break;
+    case TokenType::close_paren:
+        os << "close_paren_token, \")\"";
+        break;
+    case TokenType::name:
+        os << "name_token, \"" << symbol_name(tok.value) << '"';
+        break;
+    case TokenType::number:
+        os << "number_token, \"" << tok.value << '"';
+        break;
+    case TokenType::big_number:
+        os << "big_number_token, at " << tok.value;
+        break;
+    case TokenType::end_of_file:
+        os << "end_of_file_token, \"\"";
+        break;
+    }
 
-    os << ", \"" << tok.value << "\" }";
+    os << " }";
     return os;
 }
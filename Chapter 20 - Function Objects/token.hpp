@@ -1,22 +1,98 @@
 #ifndef CHAPTER_20_TOKEN_HPP
 #define CHAPTER_20_TOKEN_HPP
 
-#include <string>
+#include "interner.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <ostream>
 
-int const open_paren_token = 0;
-int const close_paren_token = 1;
-int const name_token = 2;
-int const number_token = 3;
-int const end_of_file_token = 4;
+enum class TokenType : std::uint8_t {
+    open_paren,
+    close_paren,
+    name,
+    number,
+    big_number,
+    end_of_file
+};
 
+// The value is the interned SymbolId for a name and the number itself for a
+// number.  Numbers too large for 64 bits are big_numbers, whose value is the
+// offset in the input at which their digits start; the digits themselves are
+// left in the input, where the lexer that found them can hand them out (see
+// get_digits).  Other tokens have a value of zero.  A Token is small, so it is
+// cheap to copy.
 struct Token {
-    int type;
-    std::string value;
+    TokenType type;
+    std::int64_t value;
+};
+
+// A whole input lexed in one go (see tokenize_all in buffer_lexer.hpp), as
+// parallel arrays with one element per token.  The last token is always an
+// end_of_file.  Each token's offset and length give where it was found in
+// the input; for a big_number, the offset is also its value.
+//
+// The four arrays grow together, so adding a token checks the capacity once
+// rather than four times, and clearing keeps the capacity: one TokenArray that
+// is reused for many inputs soon stops allocating at all.
+class TokenArray {
+    std::unique_ptr<TokenType[]> types;
+    std::unique_ptr<std::int64_t[]> values;
+    std::unique_ptr<std::size_t[]> offsets;
+    std::unique_ptr<std::uint32_t[]> lengths;
+    std::size_t count = 0;
+    std::size_t capacity = 0;
+
+    void grow();
+    void reserve(std::size_t new_capacity);
+
+public:
+    // Set if lexing stopped at a character that cannot start a token.  The
+    // final end_of_file then stands for that character, which is an error
+    // once the parser reaches it.
+    bool unrecognised = false;
+
+    std::size_t size() const {
+        return count;
+    }
+
+    Token get(std::size_t i) const {
+        return {types[i], values[i]};
+    }
+
+    std::size_t get_offset(std::size_t i) const {
+        return offsets[i];
+    }
+
+    std::size_t get_length(std::size_t i) const {
+        return lengths[i];
+    }
+
+    void clear() {
+        count = 0;
+        unrecognised = false;
+    }
+
+    // Makes the array size tokens long, leaving any new ones to be filled in
+    // with copy.
+    void resize(std::size_t size);
+
+    // Copies tokens [first, last) of other to position at onwards, adding
+    // offset to their offsets, and so to the values of big_numbers.  Different
+    // threads may copy to different positions at the same time.
+    void copy(std::size_t at, TokenArray const& other, std::size_t first, std::size_t last, std::size_t offset);
+
+    void push_back(Token token, std::size_t offset, std::size_t length) {
+        if (count == capacity)
+            grow();
+        types[count] = token.type;
+        values[count] = token.value;
+        offsets[count] = offset;
+        lengths[count] = static_cast<std::uint32_t>(length);
+        ++count;
+    }
 };
 
-bool operator==(Token const& lhs, Token const& rhs);
-bool operator!=(Token const& lhs, Token const& rhs);
 std::ostream& operator<<(std::ostream& os, Token const& tok);
 
 #endif
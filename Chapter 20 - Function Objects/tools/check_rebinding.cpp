@@ -0,0 +1,225 @@
+/* Checks that every way of evaluating an expression notices when the symbol
+ * table changes after the expression was bound, compiled or cached.  This is
+ * a separate program, so it is not built along with the rest of the chapter.
+ * From this directory:
+ *
+ *     g++ -std=c++11 -O2 -pthread -o check_rebinding check_rebinding.cpp
+ *         $(ls ../[a-z]*.cpp | grep -v main.cpp)
+ *
+ * Each mode binds (+ 2 3) once, and then evaluates it again after + has been
+ * redefined, removed and defined once more.  It then does the same for
+ * (twice (+ 1 3)), with twice defined before binding, so that the call goes
+ * through the std::function of an operation that is not a builtin; twice is
+ * then redefined and removed.  Finally (count 1), where count is not pure,
+ * is evaluated twice without any change to the table, and must not give the
+ * same result twice.  Every result must be the one a freshly bound
+ * expression would give.
+ *
+ * Last, (f 7) calls an operation that evaluates another expression, the sum
+ * of 5000 ones, before it looks at its own argument.  That evaluation pushes
+ * onto the same evaluation stack as the call to f, so f must not be handed a
+ * view of that stack.  Reading freed memory may still give the right result,
+ * so build with -fsanitize=address to be sure of catching that.  It prints each result that is not, and exits with a
+ * non-zero status if there were any.
+ */
+
+#include "../bytecode.hpp"
+#include "../flat_expression.hpp"
+#include "../line_evaluator.hpp"
+#include "../parser.hpp"
+#include "../symbol_table.hpp"
+#include "../virtual_machine.hpp"
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Multiplies instead of adding, so that it is clear which + was called.
+Integer multiply_all(Arguments args) {
+    Integer product = 1;
+    for (auto const& arg : args)
+        product = product * arg;
+    return product;
+}
+
+Integer add_all(Arguments args) {
+    Integer sum = 0;
+    for (auto const& arg : args)
+        sum = sum + arg;
+    return sum;
+}
+
+Integer twice(Arguments args) {
+    return args[0] * 2;
+}
+
+Integer three_times(Arguments args) {
+    return args[0] * 3;
+}
+
+// Not pure: each call gives a different result.
+int calls = 0;
+
+Integer count(Arguments) {
+    return ++calls;
+}
+
+// Evaluated by reentrant, which is what f stands for.
+std::shared_ptr<Expression> inner;
+SymbolTable const* inner_table = nullptr;
+
+Integer reentrant(Arguments args) {
+    Integer const sum = inner->evaluate(*inner_table);
+    return sum + args[0];
+}
+
+// Evaluates the line, as it was bound before, against the table as it is now.
+// The result is the value, or the error message after "error: ".
+using Evaluate = std::function<std::string()>;
+
+template <typename Function>
+std::string result_of(Function function) {
+    try {
+        return function().to_string();
+    }
+    catch (std::exception& e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+int failures = 0;
+
+void expect(std::string const& mode, std::string const& step, std::string const& result,
+            std::string const& expected) {
+    if (result == expected)
+        return;
+    std::cout << mode << ", " << step << ": got " << result << ", expected " << expected << '\n';
+    ++failures;
+}
+
+// A scenario prepares the table that its line is bound against, and changes
+// it between evaluations.
+struct Scenario {
+    char const* line;
+    void (*prepare)(SymbolTable& table);
+    void (*check)(std::string const& mode, SymbolTable& table, Evaluate const& evaluate);
+};
+
+void prepare_builtin(SymbolTable&) {}
+
+void check_builtin(std::string const& mode, SymbolTable& table, Evaluate const& evaluate) {
+    expect(mode, "builtin", evaluate(), "5");
+    table.define("+", multiply_all);
+    expect(mode, "after define", evaluate(), "6");
+    table.remove("+");
+    expect(mode, "after remove", evaluate(), "error: map::at");
+    table.define("+", add_all);
+    expect(mode, "after defining again", evaluate(), "5");
+}
+
+// Pure, so that --fold calls it ahead of time.
+void prepare_registered(SymbolTable& table) {
+    table.define("twice", twice, true);
+}
+
+void check_registered(std::string const& mode, SymbolTable& table, Evaluate const& evaluate) {
+    expect(mode, "registered", evaluate(), "8");
+    table.define("twice", three_times, true);
+    expect(mode, "after redefining it", evaluate(), "12");
+    table.remove("twice");
+    expect(mode, "after removing it", evaluate(), "error: map::at");
+}
+
+void prepare_impure(SymbolTable& table) {
+    calls = 0;
+    table.define("count", count);
+}
+
+void check_impure(std::string const& mode, SymbolTable&, Evaluate const& evaluate) {
+    expect(mode, "first call", evaluate(), "1");
+    expect(mode, "second call", evaluate(), "2");
+}
+
+void prepare_reentrant(SymbolTable& table) {
+    std::string line = "(+";
+    for (int i = 0; i < 5000; ++i)
+        line += " 1";
+    line += ")";
+    inner = parse_expression(StringRef(line));
+    inner_table = &table;
+    table.define("f", reentrant);
+}
+
+void check_reentrant(std::string const& mode, SymbolTable&, Evaluate const& evaluate) {
+    expect(mode, "reentrant call", evaluate(), "5007");
+}
+
+Scenario const scenarios[] = {
+    {"(+ 2 3)", prepare_builtin, check_builtin},
+    {"(twice (+ 1 3))", prepare_registered, check_registered},
+    {"(count 1)", prepare_impure, check_impure},
+    {"(f 7)", prepare_reentrant, check_reentrant},
+};
+
+void check_tree(Scenario const& scenario) {
+    SymbolTable table = get_default_symbol_table();
+    scenario.prepare(table);
+    auto expr = parse_expression(StringRef(scenario.line));
+    expr->bind(table);
+    scenario.check("tree", table, [&] { return result_of([&] { return expr->evaluate(table); }); });
+}
+
+void check_vm(Scenario const& scenario) {
+    SymbolTable table = get_default_symbol_table();
+    scenario.prepare(table);
+    auto expr = parse_expression(StringRef(scenario.line));
+    Program program = compile(*expr, table);
+    VirtualMachine vm;
+    scenario.check("vm", table, [&] { return result_of([&] { return vm.run(program, table); }); });
+}
+
+void check_flat(Scenario const& scenario) {
+    SymbolTable table = get_default_symbol_table();
+    scenario.prepare(table);
+    FlatExpression flat(*parse_expression(StringRef(scenario.line)));
+    flat.bind(table);
+    scenario.check("flat", table, [&] { return result_of([&] { return flat.evaluate(table); }); });
+}
+
+// A LineEvaluator parses every line again, so this is mostly about the
+// result cache, which must not hand out results from before the change.
+void check_line_evaluator(Scenario const& scenario, std::string const& mode, EvaluationOptions const& options) {
+    SymbolTable table = get_default_symbol_table();
+    scenario.prepare(table);
+    LineEvaluator evaluator(table, options);
+    scenario.check(mode, table, [&] {
+        LineResult const result = evaluator.evaluate(StringRef(scenario.line));
+        return result.ok ? result.text : "error: " + result.text;
+    });
+}
+
+int main() {
+    for (auto const& scenario : scenarios) {
+        check_tree(scenario);
+        check_vm(scenario);
+        check_flat(scenario);
+
+        EvaluationOptions options;
+        options.cache_bytes = 1 << 20;
+        check_line_evaluator(scenario, "cache", options);
+        options.use_vm = true;
+        check_line_evaluator(scenario, "cache, vm", options);
+        options.use_vm = false;
+        options.use_flat = true;
+        check_line_evaluator(scenario, "cache, flat", options);
+        options.use_flat = false;
+        options.fold = true;
+        check_line_evaluator(scenario, "cache, fold", options);
+    }
+
+    if (failures != 0)
+        return EXIT_FAILURE;
+    std::cout << "all modes looked the operations up again after each change\n";
+}
@@ -0,0 +1,345 @@
+/* Writes a file of random expressions, one per line, for load testing the
+ * evaluator.  This is a separate program, so it is not built along with the
+ * rest of the chapter.  From this directory:
+ *
+ *     g++ -std=c++11 -O2 -o generate generate.cpp
+ *
+ * The same options and the same seed always give the same file, on any
+ * machine and with any standard library: the generator uses its own random
+ * number generator (SplitMix64) and its own way of turning random bits into
+ * choices, rather than the <random> distributions, whose results are left to
+ * the implementation.
+ *
+ * Options:
+ *
+ *     --seed N          seed for the random number generator (1)
+ *     --lines N         number of lines to write (1000)
+ *     --depth N         maximum nesting depth of an expression (4)
+ *     --fan-out N       maximum number of arguments to + and * (4)
+ *     --digits N        maximum number of digits in a literal (6)
+ *     --mix SPEC        relative weights of the operations, written like
+ *                       +=4,-=2,*=2,/=1,let=1 (+=4,-=3,*=2,/=1)
+ *     --error-rate P    fraction of lines that contain an error (0)
+ *     --output FILE     where to write the lines (standard output)
+ *
+ * Literals of more than 18 digits do not fit in 64 bits, so --digits is also
+ * how to get arbitrary-precision arithmetic into the mix.  A divisor is
+ * always a non-zero literal, so the only division by zero is one put there
+ * on purpose.  A line with an error has one of: a division by zero, a call
+ * to a function that does not exist, the wrong number of arguments, a
+ * variable that is not bound, a missing ) or an empty list.  Each of these is
+ * rejected in every mode of the evaluator.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// SplitMix64, as in Steele, Lea and Flood, "Fast Splittable Pseudorandom
+// Number Generators".  Its output depends on nothing but the seed.
+class Random {
+    std::uint64_t state;
+
+public:
+    explicit Random(std::uint64_t seed) : state{seed} {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // A number from 0 up to but not including n.  The slight bias of the
+    // remainder doesn't matter here; being the same everywhere does.
+    std::uint64_t below(std::uint64_t n) {
+        return next() % n;
+    }
+
+    // A number from low up to and including high.
+    std::uint64_t between(std::uint64_t low, std::uint64_t high) {
+        return low + below(high - low + 1);
+    }
+
+    // True with the given probability, which is turned into a 53-bit
+    // threshold once by the caller.
+    bool chance(std::uint64_t threshold) {
+        return (next() >> 11) < threshold;
+    }
+};
+
+std::uint64_t to_threshold(double probability) {
+    if (probability <= 0)
+        return 0;
+    if (probability >= 1)
+        return std::uint64_t{1} << 53;
+    return static_cast<std::uint64_t>(probability * (std::uint64_t{1} << 53));
+}
+
+enum class Operation { add, subtract, multiply, divide, let };
+
+struct Weight {
+    Operation operation;
+    char const* name;
+    unsigned weight;
+};
+
+struct Options {
+    std::uint64_t seed = 1;
+    std::uint64_t lines = 1000;
+    int depth = 4;
+    int fan_out = 4;
+    int digits = 6;
+    std::vector<Weight> mix = {{Operation::add, "+", 4},
+                               {Operation::subtract, "-", 3},
+                               {Operation::multiply, "*", 2},
+                               {Operation::divide, "/", 1},
+                               {Operation::let, "let", 0}};
+    double error_rate = 0;
+    std::string output;
+};
+
+void parse_mix(std::string const& spec, std::vector<Weight>& mix) {
+    for (auto& weight : mix)
+        weight.weight = 0;
+    std::size_t start = 0;
+    while (start < spec.size()) {
+        auto end = spec.find(',', start);
+        if (end == std::string::npos)
+            end = spec.size();
+        auto const item = spec.substr(start, end - start);
+        auto const equals = item.find('=');
+        if (equals == std::string::npos)
+            throw std::runtime_error{"expected name=weight in --mix: " + item};
+        auto const name = item.substr(0, equals);
+        bool found = false;
+        for (auto& weight : mix) {
+            if (name == weight.name) {
+                weight.weight = std::stoul(item.substr(equals + 1));
+                found = true;
+            }
+        }
+        if (!found)
+            throw std::runtime_error{"unknown operation in --mix: " + name};
+        start = end + 1;
+    }
+}
+
+class Generator {
+    Options const& options;
+    Random random;
+    std::uint64_t error_threshold;
+    unsigned total_weight = 0;
+    // The variables bound by the lets around the current point, innermost
+    // last.  Shadowing is allowed, so a name can appear more than once.
+    std::vector<char> variables;
+    std::string line;
+
+    void literal(bool nonzero);
+    void leaf();
+    void expression(int level);
+    void call(int level);
+    void let(int level);
+    void error();
+
+public:
+    Generator(Options const& options);
+
+    // Returns the next line, without the newline.
+    std::string const& next();
+};
+
+Generator::Generator(Options const& options)
+    : options(options), random{options.seed}, error_threshold{to_threshold(options.error_rate)} {
+    for (auto const& weight : options.mix)
+        total_weight += weight.weight;
+    if (total_weight == 0)
+        throw std::runtime_error{"--mix must give some operation a weight"};
+}
+
+void Generator::literal(bool nonzero) {
+    auto const digits = random.between(1, options.digits);
+    line += static_cast<char>((nonzero || digits > 1 ? '1' + random.below(9) : '0' + random.below(10)));
+    for (std::uint64_t i = 1; i < digits; ++i)
+        line += static_cast<char>('0' + random.below(10));
+}
+
+void Generator::leaf() {
+    if (!variables.empty() && random.below(2))
+        line += variables[random.below(variables.size())];
+    else
+        literal(false);
+}
+
+// An expression at the given nesting level is a call with a probability that
+// falls off linearly with the level, and never deeper than --depth.
+void Generator::expression(int level) {
+    if (level == 0 ? options.depth > 0 : random.below(options.depth) >= static_cast<unsigned>(level))
+        call(level);
+    else
+        leaf();
+}
+
+void Generator::call(int level) {
+    auto choice = random.below(total_weight);
+    auto operation = options.mix.back().operation;
+    for (auto const& weight : options.mix) {
+        if (choice < weight.weight) {
+            operation = weight.operation;
+            break;
+        }
+        choice -= weight.weight;
+    }
+
+    switch (operation) {
+    case Operation::add:
+    case Operation::multiply: {
+        line += operation == Operation::add ? "(+" : "(*";
+        auto const count = random.between(2, options.fan_out);
+        for (std::uint64_t i = 0; i < count; ++i) {
+            line += ' ';
+            expression(level + 1);
+        }
+        break;
+    }
+    case Operation::subtract:
+        line += "(- ";
+        expression(level + 1);
+        if (random.below(4)) {
+            line += ' ';
+            expression(level + 1);
+        }
+        break;
+    case Operation::divide:
+        line += "(/ ";
+        expression(level + 1);
+        line += ' ';
+        literal(true);
+        break;
+    case Operation::let:
+        let(level);
+        return;
+    }
+    line += ')';
+}
+
+void Generator::let(int level) {
+    // The values are evaluated outside the let, so they only see the
+    // variables already in scope.
+    line += "(let (";
+    std::vector<char> names;
+    auto const count = random.between(1, std::min(options.fan_out, 8));
+    for (std::uint64_t i = 0; i < count; ++i) {
+        char name;
+        do
+            name = static_cast<char>('a' + random.below(26));
+        while (std::find(names.begin(), names.end(), name) != names.end());
+        names.push_back(name);
+        line += i == 0 ? "(" : " (";
+        line += name;
+        line += ' ';
+        expression(level + 1);
+        line += ')';
+    }
+    line += ") ";
+    variables.insert(variables.end(), names.begin(), names.end());
+    expression(level + 1);
+    variables.resize(variables.size() - names.size());
+    line += ')';
+}
+
+// Wraps or damages the line that has just been generated.
+void Generator::error() {
+    switch (random.below(6)) {
+    case 0:
+        line = "(/ " + line + " 0)";
+        break;
+    case 1:
+        line = "(undefined " + line + ")";
+        break;
+    case 2:
+        line = "(- " + line + " 1 2)";
+        break;
+    case 3:
+        line = "(+ " + line + " unbound)";
+        break;
+    case 4:
+        if (line.back() == ')')
+            line.pop_back();
+        else
+            line = '(' + line;
+        break;
+    case 5:
+        line = "(+ " + line + " ())";
+        break;
+    }
+}
+
+std::string const& Generator::next() {
+    line.clear();
+    expression(0);
+    if (random.chance(error_threshold))
+        error();
+    return line;
+}
+
+int main(int argc, char* argv[]) try {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg = argv[i];
+        if (i + 1 == argc)
+            throw std::runtime_error{"missing value for " + arg};
+        std::string const value = argv[++i];
+        if (arg == "--seed")
+            options.seed = std::stoull(value);
+        else if (arg == "--lines")
+            options.lines = std::stoull(value);
+        else if (arg == "--depth")
+            options.depth = std::stoi(value);
+        else if (arg == "--fan-out")
+            options.fan_out = std::stoi(value);
+        else if (arg == "--digits")
+            options.digits = std::stoi(value);
+        else if (arg == "--mix")
+            parse_mix(value, options.mix);
+        else if (arg == "--error-rate")
+            options.error_rate = std::stod(value);
+        else if (arg == "--output")
+            options.output = value;
+        else
+            throw std::runtime_error{"unknown option: " + arg};
+    }
+    if (options.depth < 0 || options.fan_out < 2 || options.digits < 1)
+        throw std::runtime_error{"need --depth >= 0, --fan-out >= 2 and --digits >= 1"};
+
+    FILE* out = stdout;
+    if (!options.output.empty() && !(out = std::fopen(options.output.c_str(), "wb")))
+        throw std::runtime_error{"cannot open " + options.output};
+
+    // Lines are collected into one large buffer so that a multi-gigabyte
+    // file costs a few thousand writes rather than one per line.
+    std::size_t const buffer_size = 1 << 20;
+    std::string buffer;
+    buffer.reserve(2 * buffer_size);
+    Generator generator{options};
+    for (std::uint64_t i = 0; i < options.lines; ++i) {
+        buffer += generator.next();
+        buffer += '\n';
+        if (buffer.size() >= buffer_size || i + 1 == options.lines) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size())
+                throw std::runtime_error{"error writing the output"};
+            buffer.clear();
+        }
+    }
+    if (out != stdout && std::fclose(out) != 0)
+        throw std::runtime_error{"error writing " + options.output};
+}
+catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return -1;
+}
@@ -0,0 +1,272 @@
+#include "tree_walk.hpp"
+#include "bytecode.hpp"
+#include "evaluation_stack.hpp"
+#include "hash.hpp"
+#include "let_expr.hpp"
+#include "list_expr.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// A list or let that a walk has reached, and the child it goes on with.
+// For a let, the children are the values followed by the body.
+template <typename List, typename Let>
+struct Branch {
+    List* list;
+    Let* let;
+    std::shared_ptr<Expression> const* children;
+    std::size_t size;
+    std::size_t next;
+
+    bool at_body() const { return let && next == size - 1; }
+};
+
+using ConstBranch = Branch<ListExpr const, LetExpr const>;
+
+// Returns false if the expression is neither a list nor a let.
+template <typename Node, typename List, typename Let>
+bool as_branch(Node& expr, Branch<List, Let>& branch) {
+    auto const shape = expr.shape();
+    if (shape == Expression::Shape::leaf)
+        return false;
+    branch.list = shape == Expression::Shape::list ? static_cast<List*>(&expr) : nullptr;
+    branch.let = shape == Expression::Shape::let ? static_cast<Let*>(&expr) : nullptr;
+    auto const& children = branch.list ? branch.list->get_elements() : branch.let->get_children();
+    branch.children = children.data();
+    branch.size = children.size();
+    branch.next = 0;
+    return true;
+}
+
+void print_tree(Expression const& expr, std::ostream& out) {
+    WalkStack<ConstBranch> walk;
+    auto& branches = *walk;
+    auto visit = [&](Expression const& e) {
+        ConstBranch branch;
+        if (!as_branch(e, branch)) {
+            e.print(out);
+            return;
+        }
+        out << (branch.list ? "(" : "(let (");
+        branches.push_back(branch);
+    };
+
+    visit(expr);
+    while (!branches.empty()) {
+        auto& branch = branches.back();
+        std::size_t const i = branch.next;
+        if (i == branch.size) {
+            out << ')';
+            branches.pop_back();
+            continue;
+        }
+
+        // Each variable of a let is printed as (name value), and the
+        // variables are followed by the body.
+        if (branch.list && i != 0)
+            out << ' ';
+        else if (branch.let && !branch.at_body())
+            out << (i != 0 ? ") (" : "(") << symbol_name(branch.let->get_name(i)) << ' ';
+        else if (branch.let)
+            out << (i != 0 ? ")) " : ") ");
+        branch.next += 1;
+        visit(*branch.children[i]);
+    }
+}
+
+struct HashStep {
+    ConstBranch branch;
+    std::size_t seed;
+};
+
+std::size_t hash_tree(Expression const& expr) {
+    WalkStack<HashStep> walk;
+    auto& steps = *walk;
+    std::size_t result = 0;
+    auto combine = [&](std::size_t hash) {
+        if (steps.empty())
+            result = hash;
+        else
+            steps.back().seed = hash_combine(steps.back().seed, hash);
+    };
+    auto visit = [&](Expression const& e) {
+        ConstBranch branch;
+        if (!as_branch(e, branch)) {
+            combine(e.hash());
+        } else if (branch.list) {
+            steps.push_back({branch, hash_combine(3, branch.size)});
+        } else {
+            auto const let = branch.let;
+            std::size_t seed = hash_combine(4, let->variable_count());
+            for (std::size_t i = 0; i < let->variable_count(); ++i)
+                seed = hash_combine(seed, std::hash<SymbolId>{}(let->get_name(i)));
+            steps.push_back({branch, seed});
+        }
+    };
+
+    visit(expr);
+    while (!steps.empty()) {
+        auto& step = steps.back();
+        if (step.branch.next < step.branch.size) {
+            visit(*step.branch.children[step.branch.next++]);
+            continue;
+        }
+        std::size_t const hash = step.seed;
+        steps.pop_back();
+        combine(hash);
+    }
+    return result;
+}
+
+void bind_tree(Expression const& expr, SymbolTable const& symbol_table) {
+    WalkStack<Expression const*> walk;
+    auto& pending = *walk;
+    pending.push_back(&expr);
+    while (!pending.empty()) {
+        auto const e = pending.back();
+        pending.pop_back();
+        ConstBranch branch;
+        if (!as_branch(*e, branch)) {
+            e->bind(symbol_table);
+            continue;
+        }
+        if (branch.list)
+            branch.list->resolve(symbol_table);
+        for (std::size_t i = 0; i < branch.size; ++i)
+            pending.push_back(branch.children[i].get());
+    }
+}
+
+struct EvaluationStep {
+    ConstBranch branch;
+    // Where the values of the list's arguments, or the let's variables,
+    // start on the evaluation stack.
+    std::size_t position;
+};
+
+// The arguments of a call, and the variables of a let, are pushed onto the
+// evaluation stack one after another, so that they end up next to each
+// other: a call is passed them as a single Arguments view, and a let's body
+// finds them by depth and slot.  Once the call is made, or the body has been
+// evaluated, they are replaced by the result.
+Integer evaluate_tree(Expression const& expr, SymbolTable const& symbol_table) {
+    EvaluationStack::Frame frame(get_evaluation_stack());
+    WalkStack<EvaluationStep> walk;
+    auto& steps = *walk;
+    auto visit = [&](Expression const& e) {
+        ConstBranch branch;
+        if (!as_branch(e, branch)) {
+            frame.push(e.evaluate(symbol_table));
+            return;
+        }
+        if (branch.list) {
+            if (branch.size == 0)
+                throw std::runtime_error{"evaluating empty list"};
+            // The first element names the operation.
+            branch.next = 1;
+        }
+        steps.push_back({branch, frame.size()});
+    };
+
+    visit(expr);
+    while (!steps.empty()) {
+        auto& step = steps.back();
+        if (step.branch.next < step.branch.size) {
+            if (step.branch.at_body())
+                frame.open_scope(step.position);
+            visit(*step.branch.children[step.branch.next++]);
+            continue;
+        }
+        if (step.branch.list)
+            frame.replace(step.position, step.branch.list->call(frame.arguments(step.position), symbol_table));
+        else
+            frame.close_scope();
+        steps.pop_back();
+    }
+    return frame.pop();
+}
+
+// The same steps as evaluate_tree, emitted as instructions instead.
+void compile_tree(Expression const& expr, Program& program) {
+    WalkStack<ConstBranch> walk;
+    auto& branches = *walk;
+    auto visit = [&](Expression const& e) {
+        ConstBranch branch;
+        if (!as_branch(e, branch)) {
+            e.compile(program);
+        } else if (branch.list && branch.size == 0) {
+            program.emit_fail("evaluating empty list");
+        } else {
+            if (branch.list)
+                branch.next = 1;
+            branches.push_back(branch);
+        }
+    };
+
+    visit(expr);
+    while (!branches.empty()) {
+        auto& branch = branches.back();
+        if (branch.next < branch.size) {
+            if (branch.at_body())
+                program.open_scope(branch.let->variable_count());
+            visit(*branch.children[branch.next++]);
+            continue;
+        }
+
+        if (branch.list)
+            branch.list->compile_call(program);
+        else
+            program.close_scope();
+        branches.pop_back();
+    }
+}
+
+// Each list or let stays on the stack until its children have been folded;
+// whatever a child folds to takes its place right away.
+std::shared_ptr<Expression> fold_tree(Expression& expr, SymbolTable const& symbol_table, FoldStatistics& statistics) {
+    WalkStack<Branch<ListExpr, LetExpr>> walk;
+    auto& branches = *walk;
+    std::shared_ptr<Expression> result;
+    auto replace = [&](std::shared_ptr<Expression> replacement) {
+        if (branches.empty()) {
+            result = std::move(replacement);
+            return;
+        }
+        if (!replacement)
+            return;
+        auto& branch = branches.back();
+        if (branch.list)
+            branch.list->set_element(branch.next - 1, std::move(replacement));
+        else
+            branch.let->set_child(branch.next - 1, std::move(replacement));
+    };
+    auto visit = [&](Expression& e) {
+        Branch<ListExpr, LetExpr> branch;
+        if (!as_branch(e, branch)) {
+            replace(e.fold_constants(symbol_table, statistics));
+            return;
+        }
+        // The name of the operation is never folded.
+        if (branch.list)
+            branch.next = std::min<std::size_t>(1, branch.size);
+        branches.push_back(branch);
+    };
+
+    visit(expr);
+    while (!branches.empty()) {
+        auto& branch = branches.back();
+        if (branch.next < branch.size) {
+            visit(*branch.children[branch.next++]);
+            continue;
+        }
+        // The variables themselves are never folded, so a let always stays.
+        std::shared_ptr<Expression> replacement;
+        if (branch.list)
+            replacement = branch.list->fold_call(symbol_table, statistics);
+        branches.pop_back();
+        replace(std::move(replacement));
+    }
+    return result;
+}
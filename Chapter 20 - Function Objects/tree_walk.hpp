@@ -0,0 +1,59 @@
+#ifndef CHAPTER_20_TREE_WALK_HPP
+#define CHAPTER_20_TREE_WALK_HPP
+
+#include "expression.hpp"
+#include "integer.hpp"
+#include "symbol_table.hpp"
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+struct Program;
+struct FoldStatistics;
+
+// The members of Expression that work on a whole tree, for a list or let;
+// ListExpr and LetExpr implement theirs by calling these.  Rather than
+// recursing, these keep the lists and lets they are part way through on a
+// stack of their own, so nesting is only limited by memory.  Other kinds of
+// expression have no children and are handled by their own members.
+void print_tree(Expression const& expr, std::ostream& out);
+std::size_t hash_tree(Expression const& expr);
+void bind_tree(Expression const& expr, SymbolTable const& symbol_table);
+Integer evaluate_tree(Expression const& expr, SymbolTable const& symbol_table);
+void compile_tree(Expression const& expr, Program& program);
+std::shared_ptr<Expression> fold_tree(Expression& expr, SymbolTable const& symbol_table, FoldStatistics& statistics);
+
+// The stack a walk keeps its place on.  Most trees are small and every line
+// is walked several times, so rather than allocate a new stack each time, a
+// walk borrows one that an earlier walk on the same thread has given back.
+// An operation called during a walk may start another, which then borrows a
+// stack of its own.
+template <typename T>
+class WalkStack {
+    std::vector<T> items;
+
+    static std::vector<std::vector<T>>& spares() {
+        thread_local std::vector<std::vector<T>> spares;
+        return spares;
+    }
+
+public:
+    WalkStack() {
+        auto& s = spares();
+        if (!s.empty()) {
+            items = std::move(s.back());
+            s.pop_back();
+        }
+    }
+    WalkStack(WalkStack const&) = delete;
+    ~WalkStack() {
+        items.clear();
+        spares().push_back(std::move(items));
+    }
+
+    std::vector<T>& operator*() { return items; }
+};
+
+#endif
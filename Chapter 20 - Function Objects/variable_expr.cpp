@@ -1,16 +1,60 @@
 #include "variable_expr.hpp"
+#include "bytecode.hpp"
+#include "optimizer.hpp"
+#include "hash.hpp"
+#include "evaluation_stack.hpp"
+#include <functional>
 #include <stdexcept>
 
-VariableExpr::VariableExpr(std::string const& name) : name(name) {}
+VariableExpr::VariableExpr(SymbolId symbol) : symbol(symbol) {}
+
+VariableExpr::VariableExpr(std::string const& name) : symbol(intern(name)) {}
+
+VariableExpr::VariableExpr(SymbolId symbol, int depth, int slot) : symbol(symbol), depth(depth), slot(slot) {}
 
 void VariableExpr::print(std::ostream& out) const {
-    out << name;
+    out << symbol_name(symbol);
+}
+
+std::size_t VariableExpr::hash() const {
+    return hash_combine(2, std::hash<SymbolId>{}(symbol));
+}
+
+void VariableExpr::bind(SymbolTable const&) const {}
+
+Integer VariableExpr::evaluate(SymbolTable const&) const {
+    if (!is_bound())
+        throw std::runtime_error{"unbound variable " + get_name()};
+    return get_evaluation_stack().variable(depth, slot);
+}
+
+void VariableExpr::compile(Program& program) const {
+    if (is_bound())
+        program.emit_variable(depth, slot);
+    else
+        program.emit_fail("unbound variable " + get_name());
+}
+
+std::shared_ptr<Expression> VariableExpr::fold_constants(SymbolTable const&, FoldStatistics&) {
+    return {};
+}
+
+SymbolId VariableExpr::get_symbol() const {
+    return symbol;
+}
+
+std::string const& VariableExpr::get_name() const {
+    return symbol_name(symbol);
+}
+
+bool VariableExpr::is_bound() const {
+    return depth >= 0;
 }
 
-int VariableExpr::evaluate(SymbolTable const&) const {
-    throw std::runtime_error{"variables are not yet supported"};
+int VariableExpr::get_depth() const {
+    return depth;
 }
 
-std::string VariableExpr::get_name() const {
-    return name;
+int VariableExpr::get_slot() const {
+    return slot;
 }
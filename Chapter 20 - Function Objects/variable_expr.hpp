@@ -2,19 +2,45 @@
 #define CHAPTER_20_VARIABLE_EXPR_HPP
 
 #include "expression.hpp"
+#include "interner.hpp"
 #include <string>
 
+// A name, which is either bound by an enclosing let or free.  Which one it is
+// is worked out by the parser: a bound name is turned into the number of lets
+// between it and the one that binds it (its depth) and its position among
+// that let's bindings (its slot), so evaluating it needs no lookup.
+//
+// As the head of a list, a name always refers to an operation in the symbol
+// table instead.
 class VariableExpr : public Expression {
-    std::string name;
+    SymbolId symbol;
+    int depth = -1;
+    int slot = -1;
 
 public:
-    VariableExpr(std::string const& name);
+    explicit VariableExpr(SymbolId symbol);
+    explicit VariableExpr(std::string const& name);
+    VariableExpr(SymbolId symbol, int depth, int slot);
 
     void print(std::ostream& out) const override;
 
-    int evaluate(SymbolTable const& symbol_table) const override;
+    std::size_t hash() const override;
 
-    std::string get_name() const;
+    void bind(SymbolTable const& symbol_table) const override;
+
+    Integer evaluate(SymbolTable const& symbol_table) const override;
+
+    void compile(Program& program) const override;
+
+    std::shared_ptr<Expression> fold_constants(SymbolTable const& symbol_table, FoldStatistics& statistics) override;
+
+    SymbolId get_symbol() const;
+    std::string const& get_name() const;
+
+    bool is_bound() const;
+    // Only meaningful if is_bound().
+    int get_depth() const;
+    int get_slot() const;
 };
 
 #endif
@@ -0,0 +1,56 @@
+#include "virtual_machine.hpp"
+#include "profiler.hpp"
+#include <stdexcept>
+#include <utility>
+
+Integer VirtualMachine::run(Program const& program, SymbolTable const& symbol_table) {
+    if (stack.size() < program.max_stack_depth)
+        stack.resize(program.max_stack_depth);
+
+    bool const resolved = program.generation == symbol_table.get_generation();
+    Integer* top = stack.data();
+
+    for (auto const& instruction : program.code) {
+        switch (instruction.code) {
+        case OpCode::push_number:
+            *top++ = program.constants[instruction.operand];
+            break;
+        case OpCode::load_variable:
+            *top = stack[instruction.operand];
+            ++top;
+            break;
+        case OpCode::leave_scope:
+            top[-1 - instruction.operand] = std::move(top[-1]);
+            top -= instruction.operand;
+            break;
+        case OpCode::call_add:
+        case OpCode::call_subtract:
+        case OpCode::call_multiply:
+        case OpCode::call_divide:
+            if (resolved) {
+                ProfiledCall profiled(program.function_names[instruction.operand], instruction.arg_count);
+                top -= instruction.arg_count;
+                Integer result = call_builtin(builtin_called_by(instruction.code), Arguments(top, top + instruction.arg_count));
+                *top++ = std::move(result);
+                break;
+            }
+            // Against a different table the name may no longer be the
+            // builtin, so make an ordinary call.
+            // fallthrough
+        case OpCode::call: {
+            Operation const* function = resolved ? program.functions[instruction.operand] : nullptr;
+            if (!function)
+                function = &symbol_table.at(symbol_name(program.function_names[instruction.operand]));
+            ProfiledCall profiled(program.function_names[instruction.operand], instruction.arg_count);
+            top -= instruction.arg_count;
+            Integer result = (*function)(Arguments(top, top + instruction.arg_count));
+            *top++ = std::move(result);
+            break;
+        }
+        case OpCode::fail:
+            throw std::runtime_error{program.error_messages[instruction.operand]};
+        }
+    }
+
+    return stack[0];
+}
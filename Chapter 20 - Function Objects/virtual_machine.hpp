@@ -0,0 +1,18 @@
+#ifndef CHAPTER_20_VIRTUAL_MACHINE_HPP
+#define CHAPTER_20_VIRTUAL_MACHINE_HPP
+
+#include "bytecode.hpp"
+#include "integer.hpp"
+#include "symbol_table.hpp"
+#include <vector>
+
+// Runs compiled programs.  The stack is kept between runs, so evaluating the
+// same program repeatedly does not allocate.
+class VirtualMachine {
+    std::vector<Integer> stack;
+
+public:
+    Integer run(Program const& program, SymbolTable const& symbol_table);
+};
+
+#endif